@@ -0,0 +1,514 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "amgpreconditioner.h"
+
+#include <algorithm>
+#include <cmath>
+
+// coarsening stops at this size, solved by the dense factorization
+#define AMG_COARSE_SIZE 600
+#define AMG_MAX_LEVELS 10
+
+void AMGPreconditioner::CsrMatrix::multiply(const double *x, double *y) const
+{
+#pragma omp parallel for schedule(static)
+    for(int i=0; i<m; i++)
+    {
+        double sum = 0.0;
+        for(int p=rowptr[i]; p<rowptr[i+1]; p++)
+            sum += values[p]*x[colind[p]];
+        y[i] = sum;
+    }
+}
+
+
+void AMGPreconditioner::CsrMatrix::transpose(CsrMatrix &t) const
+{
+    t.m = n;
+    t.n = m;
+    t.rowptr.assign(n+1, 0);
+    for(int p=0; p<rowptr[m]; p++)
+        t.rowptr[colind[p]+1]++;
+    for(int i=0; i<n; i++)
+        t.rowptr[i+1] += t.rowptr[i];
+
+    t.colind.resize(rowptr[m]);
+    t.values.resize(rowptr[m]);
+    std::vector<int> fill(t.rowptr.begin(), t.rowptr.end()-1);
+    for(int i=0; i<m; i++)
+        for(int p=rowptr[i]; p<rowptr[i+1]; p++)
+        {
+            int q = fill[colind[p]]++;
+            t.colind[q] = i;
+            t.values[q] = values[p];
+        }
+}
+
+
+void AMGPreconditioner::CsrMatrix::product(const CsrMatrix &b, CsrMatrix &c) const
+{
+    // row by row with a dense accumulator
+    c.m = m;
+    c.n = b.n;
+    c.rowptr.assign(1, 0);
+    c.colind.clear();
+    c.values.clear();
+
+    std::vector<double> w(b.n, 0.0);
+    std::vector<int> position(b.n, -1);
+    std::vector<int> columns;
+
+    for(int i=0; i<m; i++)
+    {
+        columns.clear();
+        for(int p=rowptr[i]; p<rowptr[i+1]; p++)
+            for(int q=b.rowptr[colind[p]]; q<b.rowptr[colind[p]+1]; q++)
+            {
+                int j = b.colind[q];
+                if(position[j] < 0)
+                {
+                    position[j] = 1;
+                    columns.push_back(j);
+                }
+                w[j] += values[p]*b.values[q];
+            }
+
+        std::sort(columns.begin(), columns.end());
+        for(size_t t=0; t<columns.size(); t++)
+        {
+            c.colind.push_back(columns[t]);
+            c.values.push_back(w[columns[t]]);
+            w[columns[t]] = 0.0;
+            position[columns[t]] = -1;
+        }
+        c.rowptr.push_back(int(c.colind.size()));
+    }
+}
+
+
+AMGPreconditioner::AMGPreconditioner(const SparseMatrix &a, const std::vector<int> &blockptr,
+                                     const std::vector<double> &nullspace, int nNullspace)
+{
+    levels.push_back(Level());
+    CsrMatrix &a0 = levels[0].A;
+    a0.m = a.n;
+    a0.n = a.n;
+    a0.rowptr = a.rowptr;
+    a0.colind = a.colind;
+    a0.values = a.values;
+
+    std::vector<int> blocks(blockptr);
+    std::vector<double> B(nullspace);
+    const int nb = nNullspace;
+
+    for(int l=0; ; l++)
+    {
+        Level &level = levels[l];
+        const CsrMatrix &A = level.A;
+        const int n = A.m;
+
+        level.dinv.resize(n);
+        for(int i=0; i<n; i++)
+        {
+            double d = 0.0;
+            for(int p=A.rowptr[i]; p<A.rowptr[i+1]; p++)
+                if(A.colind[p] == i)
+                    d = A.values[p];
+            level.dinv[i] = d!=0.0? 1.0/d : 1.0;
+        }
+
+        // spectral radius of dinv*A by power iterations
+        std::vector<double> v(n), w(n);
+        for(int i=0; i<n; i++)
+            v[i] = 1.0 + 0.1*(i%7);
+        level.lambda = 1.0;
+        for(int it=0; it<15; it++)
+        {
+            double vv = 0.0;
+            for(int i=0; i<n; i++)
+                vv += v[i]*v[i];
+            A.multiply(v.data(), w.data());
+            double ww = 0.0;
+            for(int i=0; i<n; i++)
+            {
+                w[i] *= level.dinv[i];
+                ww += w[i]*w[i];
+            }
+            level.lambda = sqrt(ww/vv);
+            for(int i=0; i<n; i++)
+                v[i] = w[i]/sqrt(ww);
+        }
+
+        level.x.resize(n);
+        level.b.resize(n);
+        level.r.resize(n);
+        level.d.resize(n);
+
+        if(n <= AMG_COARSE_SIZE || l+1 == AMG_MAX_LEVELS)
+            break;
+
+        std::vector<int> aggregates;
+        int nAggregates;
+        aggregate(A, blocks, aggregates, nAggregates);
+
+        const int nBlocks = int(blocks.size())-1;
+        if(nAggregates == nBlocks)
+            break;
+
+        // dofs of each aggregate
+        std::vector<int> aggptr(nAggregates+1, 0), aggDofs(n);
+        for(int k=0; k<nBlocks; k++)
+            aggptr[aggregates[k]+1] += blocks[k+1]-blocks[k];
+        for(int g=0; g<nAggregates; g++)
+            aggptr[g+1] += aggptr[g];
+        std::vector<int> fill(aggptr.begin(), aggptr.end()-1);
+        for(int k=0; k<nBlocks; k++)
+            for(int i=blocks[k]; i<blocks[k+1]; i++)
+                aggDofs[fill[aggregates[k]]++] = i;
+
+        // tentative prolongator: orthonormal basis of the nullspace on
+        // each aggregate (modified Gram-Schmidt), coarse nullspace = R
+        std::vector<int> coarseBlocks(1, 0);
+        std::vector<int> rowAggregate(n), rowLocal(n);
+        std::vector< std::vector<double> > Q(nAggregates), Rc(nAggregates);
+
+        for(int g=0; g<nAggregates; g++)
+        {
+            int s = aggptr[g+1]-aggptr[g];
+            std::vector<double> q, r;
+            int rank = 0;
+
+            for(int c=0; c<nb; c++)
+            {
+                std::vector<double> u(s);
+                double norm0 = 0.0;
+                for(int t=0; t<s; t++)
+                {
+                    u[t] = B[size_t(c)*n + aggDofs[aggptr[g]+t]];
+                    norm0 += u[t]*u[t];
+                }
+                norm0 = sqrt(norm0);
+
+                std::vector<double> rc(nb, 0.0);
+                for(int pass=0; pass<2; pass++)
+                    for(int j=0; j<rank; j++)
+                    {
+                        double h = 0.0;
+                        for(int t=0; t<s; t++)
+                            h += q[size_t(j)*s+t]*u[t];
+                        for(int t=0; t<s; t++)
+                            u[t] -= h*q[size_t(j)*s+t];
+                        rc[j] += h;
+                    }
+
+                double norm = 0.0;
+                for(int t=0; t<s; t++)
+                    norm += u[t]*u[t];
+                norm = sqrt(norm);
+
+                if(rank < s && norm > 1.e-8*norm0)
+                {
+                    for(int t=0; t<s; t++)
+                        q.push_back(u[t]/norm);
+                    rc[rank] = norm;
+                    rank++;
+                }
+                r.insert(r.end(), rc.begin(), rc.end()); // column c of R
+            }
+
+            Q[g].swap(q);
+            Rc[g].swap(r);
+            coarseBlocks.push_back(coarseBlocks.back()+rank);
+
+            for(int t=0; t<s; t++)
+            {
+                rowAggregate[aggDofs[aggptr[g]+t]] = g;
+                rowLocal[aggDofs[aggptr[g]+t]] = t;
+            }
+        }
+
+        const int nc = coarseBlocks.back();
+
+        CsrMatrix T;
+        T.m = n;
+        T.n = nc;
+        T.rowptr.assign(n+1, 0);
+        for(int i=0; i<n; i++)
+        {
+            int g = rowAggregate[i];
+            T.rowptr[i+1] = T.rowptr[i] + coarseBlocks[g+1]-coarseBlocks[g];
+        }
+        T.colind.resize(T.rowptr[n]);
+        T.values.resize(T.rowptr[n]);
+        for(int i=0; i<n; i++)
+        {
+            int g = rowAggregate[i];
+            int s = aggptr[g+1]-aggptr[g];
+            for(int j=0; j<coarseBlocks[g+1]-coarseBlocks[g]; j++)
+            {
+                T.colind[T.rowptr[i]+j] = coarseBlocks[g]+j;
+                T.values[T.rowptr[i]+j] = Q[g][size_t(j)*s+rowLocal[i]];
+            }
+        }
+
+        std::vector<double> Bc(size_t(nc)*nb, 0.0);
+        for(int g=0; g<nAggregates; g++)
+            for(int c=0; c<nb; c++)
+                for(int j=0; j<coarseBlocks[g+1]-coarseBlocks[g]; j++)
+                    Bc[size_t(c)*nc + coarseBlocks[g]+j] = Rc[g][size_t(c)*nb+j];
+
+        // P = (I - omega*dinv*A)*T
+        Level coarseLevel;
+        CsrMatrix AT;
+        A.product(T, AT);
+
+        double omega = 4.0/(3.0*level.lambda);
+        coarseLevel.A.m = 0;
+        level.P = AT;
+        for(int i=0; i<n; i++)
+            for(int p=AT.rowptr[i]; p<AT.rowptr[i+1]; p++)
+            {
+                int j = AT.colind[p];
+                double t = 0.0;
+                if(j>=T.colind[T.rowptr[i]] && j<T.colind[T.rowptr[i]]+T.rowptr[i+1]-T.rowptr[i])
+                    t = T.values[T.rowptr[i]+j-T.colind[T.rowptr[i]]];
+                level.P.values[p] = t - omega*level.dinv[i]*AT.values[p];
+            }
+
+        level.P.transpose(level.R);
+
+        CsrMatrix AP;
+        A.product(level.P, AP);
+        level.R.product(AP, coarseLevel.A);
+
+        blocks.swap(coarseBlocks);
+        B.swap(Bc);
+        levels.push_back(coarseLevel);
+    }
+
+    // dense Cholesky of the coarsest operator
+    const CsrMatrix &Ac = levels.back().A;
+    const int nc = Ac.m;
+    coarse.assign(size_t(nc)*nc, 0.0);
+    for(int i=0; i<nc; i++)
+        for(int p=Ac.rowptr[i]; p<Ac.rowptr[i+1]; p++)
+            coarse[size_t(i)*nc+Ac.colind[p]] = Ac.values[p];
+
+    for(int j=0; j<nc; j++)
+    {
+        double d = coarse[size_t(j)*nc+j];
+        for(int k=0; k<j; k++)
+            d -= coarse[size_t(j)*nc+k]*coarse[size_t(j)*nc+k];
+        d = d>0.0? sqrt(d) : 1.0; // singular direction left untouched
+
+        coarse[size_t(j)*nc+j] = d;
+        for(int i=j+1; i<nc; i++)
+        {
+            double s = coarse[size_t(i)*nc+j];
+            for(int k=0; k<j; k++)
+                s -= coarse[size_t(i)*nc+k]*coarse[size_t(j)*nc+k];
+            coarse[size_t(i)*nc+j] = s/d;
+        }
+    }
+}
+
+
+void AMGPreconditioner::aggregate(const CsrMatrix &a, const std::vector<int> &blockptr,
+                                  std::vector<int> &aggregates, int &nAggregates) const
+{
+    const int nBlocks = int(blockptr.size())-1;
+
+    // block graph: blocks coupled by a nonzero of a
+    std::vector<int> blockOf(a.m);
+    for(int k=0; k<nBlocks; k++)
+        for(int i=blockptr[k]; i<blockptr[k+1]; i++)
+            blockOf[i] = k;
+
+    std::vector<int> gptr(1, 0), gadj;
+    std::vector<int> mark(nBlocks, -1);
+    for(int k=0; k<nBlocks; k++)
+    {
+        for(int i=blockptr[k]; i<blockptr[k+1]; i++)
+            for(int p=a.rowptr[i]; p<a.rowptr[i+1]; p++)
+            {
+                int j = blockOf[a.colind[p]];
+                if(j!=k && mark[j]!=k)
+                {
+                    mark[j] = k;
+                    gadj.push_back(j);
+                }
+            }
+        gptr.push_back(int(gadj.size()));
+    }
+
+    aggregates.assign(nBlocks, -1);
+    nAggregates = 0;
+
+    // 1: roots whose neighbours are all free take them
+    for(int k=0; k<nBlocks; k++)
+    {
+        if(aggregates[k] >= 0)
+            continue;
+
+        bool isFree = true;
+        for(int p=gptr[k]; p<gptr[k+1] && isFree; p++)
+            if(aggregates[gadj[p]] >= 0)
+                isFree = false;
+
+        if(!isFree)
+            continue;
+
+        aggregates[k] = nAggregates;
+        for(int p=gptr[k]; p<gptr[k+1]; p++)
+            aggregates[gadj[p]] = nAggregates;
+        nAggregates++;
+    }
+
+    // 2: the others join a neighbouring aggregate of step 1
+    std::vector<int> joined(aggregates);
+    for(int k=0; k<nBlocks; k++)
+        if(aggregates[k] < 0)
+            for(int p=gptr[k]; p<gptr[k+1]; p++)
+                if(aggregates[gadj[p]] >= 0)
+                {
+                    joined[k] = aggregates[gadj[p]];
+                    break;
+                }
+    aggregates.swap(joined);
+
+    // 3: isolated leftovers form their own aggregates
+    for(int k=0; k<nBlocks; k++)
+    {
+        if(aggregates[k] >= 0)
+            continue;
+
+        aggregates[k] = nAggregates;
+        for(int p=gptr[k]; p<gptr[k+1]; p++)
+            if(aggregates[gadj[p]] < 0)
+                aggregates[gadj[p]] = nAggregates;
+        nAggregates++;
+    }
+}
+
+
+void AMGPreconditioner::smooth(const Level &level) const
+{
+    // Chebyshev polynomial of degree 2 in dinv*A on [lambda/30, 1.1*lambda]
+    const int n = level.A.m;
+    const double lmax = 1.1*level.lambda, lmin = lmax/30.0;
+    const double theta = 0.5*(lmax+lmin), delta = 0.5*(lmax-lmin);
+    const double sigma = theta/delta;
+    double rho = 1.0/sigma;
+
+    double *x = level.x.data(), *r = level.r.data(), *d = level.d.data();
+    const double *b = level.b.data(), *dinv = level.dinv.data();
+
+    level.A.multiply(x, r);
+#pragma omp parallel for schedule(static)
+    for(int i=0; i<n; i++)
+    {
+        d[i] = dinv[i]*(b[i]-r[i])/theta;
+        x[i] += d[i];
+    }
+
+    double rhoNew = 1.0/(2.0*sigma-rho);
+    level.A.multiply(x, r);
+#pragma omp parallel for schedule(static)
+    for(int i=0; i<n; i++)
+    {
+        d[i] = rhoNew*rho*d[i] + 2.0*rhoNew/delta*dinv[i]*(b[i]-r[i]);
+        x[i] += d[i];
+    }
+}
+
+
+void AMGPreconditioner::cycle(int l) const
+{
+    const Level &level = levels[l];
+    const int n = level.A.m;
+    double *x = level.x.data();
+
+    if(l+1 == int(levels.size()))
+    {
+        // coarse solve with the Cholesky factor
+        for(int i=0; i<n; i++)
+        {
+            double s = level.b[i];
+            for(int k=0; k<i; k++)
+                s -= coarse[size_t(i)*n+k]*x[k];
+            x[i] = s/coarse[size_t(i)*n+i];
+        }
+        for(int i=n-1; i>=0; i--)
+        {
+            double s = x[i];
+            for(int k=i+1; k<n; k++)
+                s -= coarse[size_t(k)*n+i]*x[k];
+            x[i] = s/coarse[size_t(i)*n+i];
+        }
+        return;
+    }
+
+    std::fill(level.x.begin(), level.x.end(), 0.0);
+    smooth(level);
+
+    // coarse-grid correction
+    double *r = level.r.data();
+    level.A.multiply(x, r);
+#pragma omp parallel for schedule(static)
+    for(int i=0; i<n; i++)
+        r[i] = level.b[i]-r[i];
+
+    const Level &next = levels[l+1];
+    level.R.multiply(r, next.b.data());
+    cycle(l+1);
+    level.P.multiply(next.x.data(), r);
+#pragma omp parallel for schedule(static)
+    for(int i=0; i<n; i++)
+        x[i] += r[i];
+
+    smooth(level);
+}
+
+
+void AMGPreconditioner::apply(const double *r, double *z) const
+{
+    std::copy(r, r+levels[0].A.m, levels[0].b.begin());
+    cycle(0);
+    std::copy(levels[0].x.begin(), levels[0].x.end(), z);
+}
+
+
+int AMGPreconditioner::nLevels(void) const
+{
+    return int(levels.size());
+}
+
+
+int AMGPreconditioner::size(int level) const
+{
+    return levels[level].A.m;
+}
+
+
+double AMGPreconditioner::complexity(void) const
+{
+    double nnz = 0.0;
+    for(size_t l=0; l<levels.size(); l++)
+        nnz += levels[l].A.rowptr.back();
+
+    return nnz/levels[0].A.rowptr.back();
+}
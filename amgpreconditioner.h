@@ -0,0 +1,76 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef AMGPRECONDITIONER_H
+#define AMGPRECONDITIONER_H
+
+#include "preconditioner.h"
+#include "sparsematrix.h"
+
+#include <vector>
+
+///
+/// \brief The AMGPreconditioner class
+/// Smoothed aggregation algebraic multigrid, one V-cycle per application.
+/// Blocks of dofs (the nodes on the fine level) are grouped into
+/// aggregates. The near-nullspace (the rigid-body modes of the mesh) is
+/// orthonormalized on each aggregate to form the tentative prolongator,
+/// which is smoothed with one damped Jacobi step. Coarse operators are
+/// Galerkin products Pt*A*P. Chebyshev polynomials smooth the levels and
+/// the coarsest level is solved with a dense Cholesky factorization.
+///
+class AMGPreconditioner : public Preconditioner
+{
+public:
+    // blockptr: dofs of each node; nullspace: nNullspace columns of a.n rows
+    AMGPreconditioner(const SparseMatrix &a, const std::vector<int> &blockptr,
+                      const std::vector<double> &nullspace, int nNullspace);
+    void apply(const double *r, double *z) const;
+
+    int nLevels(void) const;
+    int size(int level) const;
+    double complexity(void) const; // nonzeros of all levels over the fine level
+
+private:
+    struct CsrMatrix
+    {
+        int m, n;
+        std::vector<int> rowptr, colind;
+        std::vector<double> values;
+
+        void multiply(const double *x, double *y) const;
+        void transpose(CsrMatrix &t) const;
+        void product(const CsrMatrix &b, CsrMatrix &c) const; // c = this*b
+    };
+
+    struct Level
+    {
+        CsrMatrix A, P, R; // R = Pt
+        std::vector<double> dinv;
+        double lambda; // spectral radius of dinv*A
+        mutable std::vector<double> x, b, r, d;
+    };
+
+    std::vector<Level> levels;
+    std::vector<double> coarse; // Cholesky factor of the coarsest A, row by row
+
+    void aggregate(const CsrMatrix &a, const std::vector<int> &blockptr,
+                   std::vector<int> &aggregates, int &nAggregates) const;
+    void smooth(const Level &level) const;
+    void cycle(int l) const;
+};
+
+#endif // AMGPRECONDITIONER_H
@@ -0,0 +1,196 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "cdbtokenizer.h"
+
+#include <charconv>
+#include <cstring>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CdbTokenizer::CdbTokenizer()
+{
+    data = nullptr;
+    length = 0;
+    position = nullptr;
+    isMapped = false;
+    nFields = 0;
+}
+
+
+CdbTokenizer::~CdbTokenizer()
+{
+    close();
+}
+
+
+bool CdbTokenizer::open(const std::string &filename)
+{
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat info;
+    if(fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    if(info.st_size > 0)
+    {
+        void *map = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map != MAP_FAILED)
+        {
+            madvise(map, size_t(info.st_size), MADV_SEQUENTIAL);
+            data = static_cast<const char*>(map);
+            length = size_t(info.st_size);
+            isMapped = true;
+        }
+    }
+    ::close(fd);
+
+    if(!isMapped && info.st_size > 0)
+        return false;
+#else
+    // no mmap: the whole file is read into one buffer
+    std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+    if(!file)
+        return false;
+
+    length = size_t(file.tellg());
+    char *buffer = new char[length+1];
+    file.seekg(0);
+    file.read(buffer, std::streamsize(length));
+    data = buffer;
+#endif
+
+    position = data;
+    return true;
+}
+
+
+void CdbTokenizer::close(void)
+{
+#ifndef _WIN32
+    if(isMapped)
+        munmap(const_cast<char*>(data), length);
+#else
+    delete[] data;
+#endif
+
+    data = nullptr;
+    length = 0;
+    position = nullptr;
+    isMapped = false;
+    nFields = 0;
+}
+
+
+bool CdbTokenizer::readLine(void)
+{
+    nFields = 0;
+
+    const char *end = data+length;
+    if(position == nullptr || position >= end)
+        return false;
+
+    const char *eol = static_cast<const char*>(std::memchr(position, '\n', size_t(end-position)));
+    const char *next = eol? eol+1 : end;
+    if(eol == nullptr)
+        eol = end;
+    if(eol > position && eol[-1] == '\r')
+        eol--;
+
+    // fields between commas, the empty ones are skipped
+    const char *p = position;
+    while(p <= eol && nFields < CDB_MAX_FIELDS)
+    {
+        const char *comma = static_cast<const char*>(std::memchr(p, ',', size_t(eol-p)));
+        if(comma == nullptr)
+            comma = eol;
+
+        if(comma > p)
+        {
+            fieldBegin[nFields] = p;
+            fieldEnd[nFields] = comma;
+            nFields++;
+        }
+        p = comma+1;
+    }
+
+    position = next;
+    return true;
+}
+
+
+bool CdbTokenizer::is(int i, const char *keyword) const
+{
+    if(i >= nFields)
+        return false;
+
+    size_t n = std::strlen(keyword);
+    return size_t(fieldEnd[i]-fieldBegin[i]) == n && std::memcmp(fieldBegin[i], keyword, n) == 0;
+}
+
+
+int CdbTokenizer::toInt(int i) const
+{
+    int value = 0;
+    if(i >= nFields)
+        return value;
+
+    // the numbers are right aligned in the fixed format lines
+    const char *p = fieldBegin[i];
+    while(p < fieldEnd[i] && (*p == ' ' || *p == '\t' || *p == '+'))
+        p++;
+
+    std::from_chars(p, fieldEnd[i], value);
+    return value;
+}
+
+
+double CdbTokenizer::toDouble(int i) const
+{
+    double value = 0.0;
+    if(i >= nFields)
+        return value;
+
+    const char *p = fieldBegin[i];
+    while(p < fieldEnd[i] && (*p == ' ' || *p == '\t' || *p == '+'))
+        p++;
+
+    std::from_chars(p, fieldEnd[i], value);
+    return value;
+}
+
+
+std::string CdbTokenizer::toString(int i) const
+{
+    if(i >= nFields)
+        return std::string();
+
+    return std::string(fieldBegin[i], fieldEnd[i]);
+}
@@ -0,0 +1,62 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef CDBTOKENIZER_H
+#define CDBTOKENIZER_H
+
+#include <cstddef>
+#include <string>
+
+// fields kept per line; the CDB records read here use at most 8
+#define CDB_MAX_FIELDS 16
+
+///
+/// \brief The CdbTokenizer class
+/// Line by line reader of CDB files. The file is mapped in memory and each
+/// line is split at the commas in place: the fields are pointers into the
+/// mapping (empty fields are skipped, as QString::SkipEmptyParts did) and
+/// the numbers are converted with std::from_chars, so reading a mesh makes
+/// no allocation per line.
+///
+class CdbTokenizer
+{
+public:
+    CdbTokenizer();
+    ~CdbTokenizer();
+
+    bool open(const std::string &filename);
+    void close(void);
+    bool readLine(void);
+
+    int count(void) const { return nFields; }
+    size_t size(void) const { return length; }
+    bool is(int i, const char *keyword) const;
+    int toInt(int i) const;
+    double toDouble(int i) const;
+    std::string toString(int i) const;
+
+private:
+    const char *data;
+    size_t length;
+    const char *position;
+    bool isMapped;
+
+    int nFields;
+    const char *fieldBegin[CDB_MAX_FIELDS];
+    const char *fieldEnd[CDB_MAX_FIELDS];
+};
+
+#endif // CDBTOKENIZER_H
@@ -0,0 +1,222 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "dofmap.h"
+
+#include <algorithm>
+#include <utility>
+
+DofMap::DofMap()
+{
+    nDofs = 0;
+    nFree = 0;
+}
+
+
+void DofMap::renumber(int nNodes, const int *connectivity, int nElements, int nodesPerElement)
+{
+    // nodal graph: node i is coupled with node j if they share an element
+    std::vector<int> adjptr(nNodes+1, 0), adjacency;
+    std::vector< std::vector<int> > neighbours(nNodes);
+    for(int iel=0; iel<nElements; iel++)
+    {
+        const int *enodes = connectivity + iel*nodesPerElement;
+        for(int i=0; i<nodesPerElement; i++)
+            for(int j=0; j<nodesPerElement; j++)
+                if(enodes[i] != enodes[j])
+                    neighbours[enodes[i]].push_back(enodes[j]);
+    }
+
+    for(int i=0; i<nNodes; i++)
+    {
+        std::sort(neighbours[i].begin(), neighbours[i].end());
+        neighbours[i].erase(std::unique(neighbours[i].begin(), neighbours[i].end()), neighbours[i].end());
+        adjacency.insert(adjacency.end(), neighbours[i].begin(), neighbours[i].end());
+        adjptr[i+1] = int(adjacency.size());
+        std::vector<int>().swap(neighbours[i]);
+    }
+
+    // Cuthill-McKee from a pseudo-peripheral node of each component,
+    // neighbours by increasing degree; the order is reversed at the end
+    std::vector<int> level(nNodes, -1), queue;
+    std::vector< std::pair<int,int> > candidates; // (degree, node)
+    std::vector<bool> isNumbered(nNodes, false);
+    nodeOrder.clear();
+    nodeOrder.reserve(nNodes);
+
+    for(int start=0; start<nNodes; start++)
+    {
+        if(isNumbered[start])
+            continue;
+
+        // George-Liu: restart from a node of minimum degree in the last
+        // level while the eccentricity grows
+        int root = start, eccentricity = -1;
+        for(int sweep=0; sweep<8; sweep++)
+        {
+            queue.assign(1, root);
+            level[root] = 0;
+            for(size_t q=0; q<queue.size(); q++)
+                for(int p=adjptr[queue[q]]; p<adjptr[queue[q]+1]; p++)
+                    if(level[adjacency[p]] < 0)
+                    {
+                        level[adjacency[p]] = level[queue[q]]+1;
+                        queue.push_back(adjacency[p]);
+                    }
+
+            int depth = level[queue.back()], next = queue.back();
+            for(size_t q=0; q<queue.size(); q++)
+            {
+                int v = queue[q];
+                if(level[v]==depth && adjptr[v+1]-adjptr[v] < adjptr[next+1]-adjptr[next])
+                    next = v;
+                level[v] = -1;
+            }
+
+            if(depth <= eccentricity)
+                break;
+            eccentricity = depth;
+            root = next;
+        }
+
+        size_t first = nodeOrder.size();
+        nodeOrder.push_back(root);
+        isNumbered[root] = true;
+        for(size_t q=first; q<nodeOrder.size(); q++)
+        {
+            int v = nodeOrder[q];
+            candidates.clear();
+            for(int p=adjptr[v]; p<adjptr[v+1]; p++)
+            {
+                int u = adjacency[p];
+                if(!isNumbered[u])
+                {
+                    isNumbered[u] = true;
+                    candidates.push_back(std::make_pair(adjptr[u+1]-adjptr[u], u));
+                }
+            }
+
+            std::sort(candidates.begin(), candidates.end());
+            for(size_t t=0; t<candidates.size(); t++)
+                nodeOrder.push_back(candidates[t].second);
+        }
+    }
+
+    std::reverse(nodeOrder.begin(), nodeOrder.end());
+}
+
+
+void DofMap::setNodes(Node3D **nodes, int nNodes)
+{
+    nDofs = 3*nNodes;
+    equation.assign(nDofs, 0);
+    prescribed.assign(nDofs, 0.0);
+
+    for(int i=0; i<nNodes; i++)
+        for(int j=0; j<3; j++)
+            if(nodes[i]->restrictions[j]==true)
+            {
+                int n = 3*nodes[i]->index+j;
+                equation[n] = -1;
+                prescribed[n] = nodes[i]->displacements[j];
+            }
+
+    // free dofs are numbered node by node in the order of nodeOrder
+    nFree = 0;
+    for(int t=0; t<nNodes; t++)
+    {
+        int i = nodeOrder.empty()? t : nodeOrder[t];
+        for(int j=0; j<3; j++)
+            if(equation[3*i+j] >= 0)
+                equation[3*i+j] = nFree++;
+    }
+}
+
+
+bool DofMap::hasPrescribedValues(void) const
+{
+    for(int n=0; n<nDofs; n++)
+        if(prescribed[n] != 0.0)
+            return true;
+
+    return false;
+}
+
+
+void DofMap::nodeBlocks(std::vector<int> &blockptr) const
+{
+    // nodes in the order of their equations
+    blockptr.assign(1, 0);
+
+    for(int t=0; t<nDofs/3; t++)
+    {
+        int n = 3*(nodeOrder.empty()? t : nodeOrder[t]);
+        int s = 0;
+        for(int j=0; j<3; j++)
+            if(equation[n+j] >= 0)
+                s++;
+
+        if(s > 0)
+            blockptr.push_back(blockptr.back()+s);
+    }
+}
+
+
+void DofMap::rigidBodyModes(Node3D **nodes, int nNodes, std::vector<double> &modes) const
+{
+    // rotations about the centroid keep the modes well scaled
+    double centroid[3] = {0.0, 0.0, 0.0};
+    for(int i=0; i<nNodes; i++)
+        for(int j=0; j<3; j++)
+            centroid[j] += nodes[i]->coordinates[j]/nNodes;
+
+    modes.assign(6*size_t(nFree), 0.0);
+    for(int i=0; i<nNodes; i++)
+    {
+        double x = nodes[i]->coordinates[0]-centroid[0];
+        double y = nodes[i]->coordinates[1]-centroid[1];
+        double z = nodes[i]->coordinates[2]-centroid[2];
+
+        // translations x, y, z and rotations about z, x, y
+        const double mode[6][3] = { {1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0},
+                                    {-y, x, 0.0}, {0.0, -z, y}, {z, 0.0, -x} };
+
+        for(int j=0; j<3; j++)
+        {
+            int e = equation[3*nodes[i]->index+j];
+            if(e < 0)
+                continue;
+
+            for(int m=0; m<6; m++)
+                modes[size_t(m)*nFree+e] = mode[m][j];
+        }
+    }
+}
+
+
+void DofMap::restrict(const double *full, double *reduced) const
+{
+    for(int n=0; n<nDofs; n++)
+        if(equation[n] >= 0)
+            reduced[equation[n]] = full[n];
+}
+
+
+void DofMap::expand(const double *reduced, double *full) const
+{
+    for(int n=0; n<nDofs; n++)
+        full[n] = equation[n]>=0? reduced[equation[n]] : prescribed[n];
+}
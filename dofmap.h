@@ -0,0 +1,55 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef DOFMAP_H
+#define DOFMAP_H
+
+#include "node3d.h"
+
+#include <vector>
+#include <cstddef>
+
+///
+/// \brief The DofMap class
+/// Numbering of the free dofs (3 per node) as equations of the reduced
+/// system; restricted dofs are eliminated and keep their prescribed
+/// displacement, which is lifted to the right-hand side. The equations
+/// follow a reverse Cuthill-McKee order of the nodes, so the bandwidth of
+/// the stiffness matrix no longer depends on the mesher numbering.
+///
+class DofMap
+{
+public:
+    int nDofs; // all dofs
+    int nFree; // equations of the reduced system
+
+    std::vector<int> equation;      // equation of each dof, -1 if restricted
+    std::vector<double> prescribed; // prescribed displacement of each dof
+    std::vector<int> nodeOrder;     // node of each position of the numbering, empty: natural order
+
+    DofMap();
+
+    void renumber(int nNodes, const int *connectivity, int nElements, int nodesPerElement);
+    void setNodes(Node3D **nodes, int nNodes);
+    bool hasPrescribedValues(void) const;
+    void nodeBlocks(std::vector<int> &blockptr) const; // free equations of each node
+    void rigidBodyModes(Node3D **nodes, int nNodes, std::vector<double> &modes) const; // 6 columns of nFree rows
+
+    void restrict(const double *full, double *reduced) const;
+    void expand(const double *reduced, double *full) const;
+};
+
+#endif // DOFMAP_H
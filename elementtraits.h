@@ -0,0 +1,43 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef ELEMENTTRAITS_H
+#define ELEMENTTRAITS_H
+
+class Solid3DElement;
+class Truss3DElement;
+
+///
+/// \brief The ElementTraits struct
+/// Compile-time sizes of each element type, used to size the stack arrays
+/// of the element kernels (ke, B, stresses).
+///
+template<class Element>
+struct ElementTraits;
+
+template<>
+struct ElementTraits<Solid3DElement>
+{
+    enum { nNodes = 4, nDofs = 12, nStress = 6, nKe = nDofs*nDofs };
+};
+
+template<>
+struct ElementTraits<Truss3DElement>
+{
+    enum { nNodes = 2, nDofs = 6, nStress = 1, nKe = nDofs*nDofs };
+};
+
+#endif // ELEMENTTRAITS_H
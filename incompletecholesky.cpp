@@ -0,0 +1,318 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "incompletecholesky.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <utility>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+IncompleteCholeskyPreconditioner::IncompleteCholeskyPreconditioner(const SparseMatrix &a, double dropTolerance, int fill)
+{
+    n = a.n;
+
+    // shifted retries until every pivot is positive
+    shift = 0.0;
+    isLevelScheduled = false;
+    isFactorized = factorize(a, shift, dropTolerance, fill);
+    while(!isFactorized && shift < 1.0)
+    {
+        shift = shift==0.0? 1.e-3 : 2.0*shift;
+        isFactorized = factorize(a, shift, dropTolerance, fill);
+    }
+
+    // a partial factor is useless, the caller falls back to another method
+    if(!isFactorized)
+    {
+        lrowptr.assign(n+1, 0);
+        lcolind.clear();
+        lvalues.clear();
+        flevelptr.assign(1, 0);
+        blevelptr.assign(1, 0);
+        return;
+    }
+
+    // Lt: transpose of L
+    urowptr.assign(n+1, 0);
+    for(int t=0; t<lrowptr[n]; t++)
+        urowptr[lcolind[t]+1]++;
+    for(int i=0; i<n; i++)
+        urowptr[i+1] += urowptr[i];
+
+    ucolind.resize(lrowptr[n]);
+    uvalues.resize(lrowptr[n]);
+    std::vector<int> position(urowptr.begin(), urowptr.end()-1);
+    for(int i=0; i<n; i++)
+        for(int p=lrowptr[i]; p<lrowptr[i+1]; p++)
+        {
+            int q = position[lcolind[p]]++;
+            ucolind[q] = i;
+            uvalues[q] = lvalues[p];
+        }
+
+    evalLevels();
+
+    // narrow levels do not pay for the synchronization
+    int nThreads = 1;
+#ifdef _OPENMP
+    nThreads = omp_get_max_threads();
+#endif
+    isLevelScheduled = nThreads>1 && n >= 32*nThreads*nLevels();
+}
+
+
+bool IncompleteCholeskyPreconditioner::factorize(const SparseMatrix &a, double alpha, double dropTolerance, int fill)
+{
+    // up-looking factorization: row i of L solves L(0:i,0:i)*l_i = a_i by
+    // sparse forward substitution, using the columns of the rows above
+    std::vector< std::vector< std::pair<int,double> > > columns(n);
+    std::vector<double> w(n, 0.0);
+    std::vector<char> mark(n, 0), inPattern(n, 0);
+    std::vector<int> nonzeros;
+    std::vector< std::pair<double,int> > row;
+
+    lrowptr.assign(1, 0);
+    lcolind.clear();
+    lvalues.clear();
+
+    for(int i=0; i<n; i++)
+    {
+        std::priority_queue<int, std::vector<int>, std::greater<int> > heap;
+        double aii = 0.0, norm = 0.0;
+
+        for(int p=a.rowptr[i]; p<a.rowptr[i+1]; p++)
+        {
+            int j = a.colind[p];
+            norm += a.values[p]*a.values[p];
+            if(j < i)
+            {
+                w[j] = a.values[p];
+                mark[j] = 1;
+                inPattern[j] = 1;
+                nonzeros.push_back(j);
+                heap.push(j);
+            }
+            else if(j == i)
+                aii = a.values[p];
+        }
+        norm = sqrt(norm);
+
+        double d = aii*(1.0+alpha);
+        row.clear();
+
+        while(!heap.empty())
+        {
+            int j = heap.top();
+            heap.pop();
+
+            if(w[j] == 0.0)
+                continue;
+            if(!inPattern[j] && std::fabs(w[j]) < dropTolerance*norm)
+                continue;
+
+            double lij = w[j]/lvalues[lrowptr[j+1]-1];
+
+            for(size_t t=0; t<columns[j].size(); t++)
+            {
+                int k = columns[j][t].first;
+                if(!mark[k])
+                {
+                    if(dropTolerance <= 0.0) // IC(0): no fill outside A
+                        continue;
+                    mark[k] = 1;
+                    w[k] = 0.0;
+                    nonzeros.push_back(k);
+                    heap.push(k);
+                }
+                w[k] -= lij*columns[j][t].second;
+            }
+
+            row.push_back(std::make_pair(lij, j));
+        }
+
+        // ICT: keep the pattern of A plus the fill largest entries
+        if(dropTolerance > 0.0)
+        {
+            std::vector< std::pair<double,int> > kept, extra;
+            for(size_t t=0; t<row.size(); t++)
+                (inPattern[row[t].second]? kept : extra).push_back(row[t]);
+
+            if(int(extra.size()) > fill)
+            {
+                std::nth_element(extra.begin(), extra.begin()+fill, extra.end(),
+                                 [](const std::pair<double,int> &x, const std::pair<double,int> &y)
+                                 { return std::fabs(x.first) > std::fabs(y.first); });
+                extra.resize(fill);
+            }
+
+            row.swap(kept);
+            row.insert(row.end(), extra.begin(), extra.end());
+        }
+
+        for(size_t t=0; t<nonzeros.size(); t++)
+        {
+            w[nonzeros[t]] = 0.0;
+            mark[nonzeros[t]] = 0;
+            inPattern[nonzeros[t]] = 0;
+        }
+        nonzeros.clear();
+
+        std::sort(row.begin(), row.end(),
+                  [](const std::pair<double,int> &x, const std::pair<double,int> &y)
+                  { return x.second < y.second; });
+
+        for(size_t t=0; t<row.size(); t++)
+        {
+            d -= row[t].first*row[t].first;
+            lcolind.push_back(row[t].second);
+            lvalues.push_back(row[t].first);
+            columns[row[t].second].push_back(std::make_pair(i, row[t].first));
+        }
+
+        if(!(d > 1.e-12*std::fabs(aii)))
+            return false;
+
+        lcolind.push_back(i);
+        lvalues.push_back(sqrt(d));
+        lrowptr.push_back(int(lcolind.size()));
+    }
+
+    return true;
+}
+
+
+void IncompleteCholeskyPreconditioner::evalLevels(void)
+{
+    // forward: a row follows every row of its off-diagonal entries
+    std::vector<int> level(n, 0);
+    int nf = 0;
+    for(int i=0; i<n; i++)
+    {
+        for(int p=lrowptr[i]; p<lrowptr[i+1]-1; p++)
+            if(level[lcolind[p]]+1 > level[i])
+                level[i] = level[lcolind[p]]+1;
+        if(level[i]+1 > nf)
+            nf = level[i]+1;
+    }
+
+    flevelptr.assign(nf+1, 0);
+    for(int i=0; i<n; i++)
+        flevelptr[level[i]+1]++;
+    for(int l=0; l<nf; l++)
+        flevelptr[l+1] += flevelptr[l];
+    flevelRows.resize(n);
+    std::vector<int> fill(flevelptr.begin(), flevelptr.end()-1);
+    for(int i=0; i<n; i++)
+        flevelRows[fill[level[i]]++] = i;
+
+    // backward: same on Lt, from the last row
+    level.assign(n, 0);
+    int nb = 0;
+    for(int i=n-1; i>=0; i--)
+    {
+        for(int p=urowptr[i]+1; p<urowptr[i+1]; p++)
+            if(level[ucolind[p]]+1 > level[i])
+                level[i] = level[ucolind[p]]+1;
+        if(level[i]+1 > nb)
+            nb = level[i]+1;
+    }
+
+    blevelptr.assign(nb+1, 0);
+    for(int i=0; i<n; i++)
+        blevelptr[level[i]+1]++;
+    for(int l=0; l<nb; l++)
+        blevelptr[l+1] += blevelptr[l];
+    blevelRows.resize(n);
+    fill.assign(blevelptr.begin(), blevelptr.end()-1);
+    for(int i=0; i<n; i++)
+        blevelRows[fill[level[i]]++] = i;
+}
+
+
+int IncompleteCholeskyPreconditioner::nLevels(void) const
+{
+    return int(flevelptr.size())-1;
+}
+
+
+int IncompleteCholeskyPreconditioner::nnz(void) const
+{
+    return lrowptr[n];
+}
+
+
+void IncompleteCholeskyPreconditioner::apply(const double *r, double *z) const
+{
+    if(!isLevelScheduled)
+    {
+        for(int i=0; i<n; i++)
+        {
+            double s = r[i];
+            for(int p=lrowptr[i]; p<lrowptr[i+1]-1; p++)
+                s -= lvalues[p]*z[lcolind[p]];
+            z[i] = s/lvalues[lrowptr[i+1]-1];
+        }
+
+        for(int i=n-1; i>=0; i--)
+        {
+            double s = z[i];
+            for(int p=urowptr[i]+1; p<urowptr[i+1]; p++)
+                s -= uvalues[p]*z[ucolind[p]];
+            z[i] = s/uvalues[urowptr[i]];
+        }
+        return;
+    }
+
+    const int nf = int(flevelptr.size())-1;
+    const int nb = int(blevelptr.size())-1;
+
+#pragma omp parallel
+    {
+        // L*y = r, y stored in z
+        for(int l=0; l<nf; l++)
+        {
+#pragma omp for schedule(static)
+            for(int t=flevelptr[l]; t<flevelptr[l+1]; t++)
+            {
+                int i = flevelRows[t];
+                double s = r[i];
+                for(int p=lrowptr[i]; p<lrowptr[i+1]-1; p++)
+                    s -= lvalues[p]*z[lcolind[p]];
+                z[i] = s/lvalues[lrowptr[i+1]-1];
+            }
+        }
+
+        // Lt*z = y
+        for(int l=0; l<nb; l++)
+        {
+#pragma omp for schedule(static)
+            for(int t=blevelptr[l]; t<blevelptr[l+1]; t++)
+            {
+                int i = blevelRows[t];
+                double s = z[i];
+                for(int p=urowptr[i]+1; p<urowptr[i+1]; p++)
+                    s -= uvalues[p]*z[ucolind[p]];
+                z[i] = s/uvalues[urowptr[i]];
+            }
+        }
+    }
+}
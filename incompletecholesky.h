@@ -0,0 +1,65 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef INCOMPLETECHOLESKY_H
+#define INCOMPLETECHOLESKY_H
+
+#include "preconditioner.h"
+#include "sparsematrix.h"
+
+#include <vector>
+
+///
+/// \brief The IncompleteCholeskyPreconditioner class
+/// Incomplete factorization A ~ L*Lt, computed row by row. With a zero drop
+/// tolerance it is IC(0), on the lower pattern of A; otherwise it is ICT:
+/// fill-in is accepted, entries below dropTolerance*|a_i| are discarded
+/// and each row keeps its fill largest entries plus the pattern of A. A
+/// diagonal shift A + alpha*diag(A) is applied when a pivot breaks down.
+/// The triangular solves are level scheduled: rows of the same level only
+/// depend on rows of previous levels and are solved in parallel.
+///
+class IncompleteCholeskyPreconditioner : public Preconditioner
+{
+public:
+    double shift;      // alpha used by the factorization
+    bool isFactorized; // false if every shift broke down
+
+    IncompleteCholeskyPreconditioner(const SparseMatrix &a, double dropTolerance = 0.0, int fill = 0);
+    void apply(const double *r, double *z) const;
+
+    int nLevels(void) const; // forward solve
+    int nnz(void) const;     // entries of L
+
+private:
+    int n;
+    bool isLevelScheduled;
+
+    // L row by row (diagonal last) and Lt row by row (diagonal first)
+    std::vector<int> lrowptr, lcolind;
+    std::vector<double> lvalues;
+    std::vector<int> urowptr, ucolind;
+    std::vector<double> uvalues;
+
+    // rows grouped by level for the forward and backward solves
+    std::vector<int> flevelptr, flevelRows;
+    std::vector<int> blevelptr, blevelRows;
+
+    bool factorize(const SparseMatrix &a, double alpha, double dropTolerance, int fill);
+    void evalLevels(void);
+};
+
+#endif // INCOMPLETECHOLESKY_H
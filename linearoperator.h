@@ -0,0 +1,40 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef LINEAROPERATOR_H
+#define LINEAROPERATOR_H
+
+///
+/// \brief The LinearOperator class
+/// Symmetric operator y = A*x seen by the iterative solvers, either an
+/// assembled matrix or a matrix-free product over the elements, with the
+/// diagonal data used by the Jacobi preconditioners.
+///
+class LinearOperator
+{
+public:
+    virtual ~LinearOperator() {}
+
+    virtual int size(void) const = 0;
+    virtual void multiply(const double *x, double *y) const = 0;
+    virtual void diagonal(double *d) const = 0;
+
+    // diagonal blocks of rows blockptr[k] to blockptr[k+1]-1 (at most 3),
+    // stored as 3x3 row by row
+    virtual void diagonalBlocks(const int *blockptr, int nBlocks, double *blocks) const = 0;
+};
+
+#endif // LINEAROPERATOR_H
@@ -0,0 +1,494 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "linearsolver.h"
+#include "incompletecholesky.h"
+#include "amgpreconditioner.h"
+#include "msglog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <QElapsedTimer>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <mth/matrix.h>
+
+// iterative refinement of the mixed precision Cholesky: steps while the
+// residual decreases at least by this factor
+#define REFINEMENT_MAX_STEPS 20
+#define REFINEMENT_MIN_REDUCTION 0.5
+
+static double dot(const std::vector<double> &a, const std::vector<double> &b)
+{
+    const int n = int(a.size());
+    double sum = 0.0;
+
+#pragma omp parallel for schedule(static) reduction(+:sum)
+    for(int i=0; i<n; i++)
+        sum += a[i]*b[i];
+
+    return sum;
+}
+
+LinearSolver::LinearSolver()
+{
+    direct = sparseCholesky;
+    preconditioning = blockJacobi;
+    tolerance = 1.e-10;
+    maxIterations = -1;
+    dropTolerance = 1.e-4;
+    fill = 80;
+    warmStartSize = 4;
+
+    factorizationKey = 0;
+    cholesky = nullptr;
+    skylineFactor = nullptr;
+    preconditioner = nullptr;
+}
+
+
+LinearSolver::~LinearSolver()
+{
+    clearFactorization();
+}
+
+
+void LinearSolver::clearFactorization(void)
+{
+    delete cholesky;
+    delete skylineFactor;
+    delete preconditioner;
+    cholesky = nullptr;
+    skylineFactor = nullptr;
+    preconditioner = nullptr;
+    factorizationKey = 0;
+}
+
+
+void LinearSolver::adoptFactorization(LinearSolver &solver)
+{
+    clearFactorization();
+    std::swap(factorizationKey, solver.factorizationKey);
+    std::swap(cholesky, solver.cholesky);
+    std::swap(skylineFactor, solver.skylineFactor);
+    std::swap(preconditioner, solver.preconditioner);
+    preconditionerName = solver.preconditionerName;
+    solutions.swap(solver.solutions);
+}
+
+
+unsigned long long LinearSolver::cacheKey(const LinearOperator &k, int method) const
+{
+    // only an assembled matrix can be hashed
+    const SparseMatrix *a = dynamic_cast<const SparseMatrix*>(&k);
+    if(a == nullptr)
+        return 0;
+
+    const unsigned long long prime = 1099511628211ULL;
+    unsigned long long h = a->hash();
+    h = (h ^ (unsigned long long)(method)) * prime;
+    if(method == incompleteCholesky)
+    {
+        h = (h ^ (unsigned long long)(fill)) * prime;
+        h = (h ^ (unsigned long long)(dropTolerance*1.e12)) * prime;
+    }
+
+    return h!=0? h : 1;
+}
+
+
+void LinearSolver::solve(const SparseMatrix &k, const DofMap &dofs, const std::vector<double> &f,
+                         std::vector<double> &x, bool isIterative, int nRhs)
+{
+    int nThreads = 1;
+#ifdef _OPENMP
+    nThreads = omp_get_max_threads();
+#endif
+
+    const int n = k.n;
+    x.assign(size_t(n)*nRhs, 0.0);
+
+    if(isIterative)
+    {
+        MsgLog::information(QString("Iterative solver, sparse matrix on CPU (%1 threads)").arg(nThreads));
+
+        // the preconditioner of the first column is reused by the others
+        std::vector<double> fc(n), xc;
+        for(int c=0; c<nRhs; c++)
+        {
+            std::copy(f.begin()+size_t(c)*n, f.begin()+size_t(c+1)*n, fc.begin());
+            solveIterative(k, dofs, fc, xc);
+            std::copy(xc.begin(), xc.end(), x.begin()+size_t(c)*n);
+        }
+    }
+    else if(direct == sparseCholesky || direct == mixedCholesky)
+    {
+        MsgLog::information(QString("Direct solver, %1 sparse Cholesky on CPU (%2 threads)")
+                            .arg(direct==mixedCholesky? "mixed precision" : "double precision").arg(nThreads));
+
+        unsigned long long key = cacheKey(k, 100+direct);
+        if(cholesky && key==factorizationKey)
+            MsgLog::information(QString("Stiffness matrix unchanged, factorization reused"));
+        else
+        {
+            clearFactorization();
+            if(!factorizeCholesky(k, dofs, direct==mixedCholesky))
+                return;
+            factorizationKey = key;
+        }
+
+        if(!cholesky->isSinglePrecision)
+            cholesky->solve(f.data(), x.data(), nRhs);
+        else if(!refineSolution(k, f, x, nRhs))
+        {
+            // the double factor stays cached for the next solves
+            MsgLog::information(QString("Iterative refinement stalled, factorizing in double precision"));
+            if(!factorizeCholesky(k, dofs, false))
+            {
+                clearFactorization();
+                return;
+            }
+            cholesky->solve(f.data(), x.data(), nRhs);
+        }
+    }
+    else if(direct == skyline)
+    {
+        unsigned long long key = cacheKey(k, 100+skyline);
+        if(skylineFactor && key==factorizationKey)
+            MsgLog::information(QString("Direct solver, skyline LDLt on CPU: stiffness matrix unchanged, factorization reused"));
+        else
+        {
+            clearFactorization();
+            skylineFactor = new SkylineSolver;
+            skylineFactor->analyse(k);
+            MsgLog::information(QString("Direct solver, skyline LDLt on CPU (bandwidth %1, %2 entries, %3 MB)")
+                                .arg(skylineFactor->bandwidth()).arg(skylineFactor->profile())
+                                .arg(skylineFactor->profile()*sizeof(double)/1048576.));
+            QElapsedTimer timer;
+            timer.start();
+
+            if(!skylineFactor->factorize(k))
+            {
+                MsgLog::error(QString("Stiffness matrix is singular (equation %1), check the restrictions")
+                              .arg(skylineFactor->failedEquation));
+                clearFactorization();
+                return;
+            }
+            factorizationKey = key;
+
+            MsgLog::information(QString("Skyline factorization in %1 s").arg(timer.elapsed()/1000.));
+        }
+        skylineFactor->solve(f.data(), x.data(), nRhs);
+    }
+    else
+    {
+        MsgLog::information(QString("Direct solver, dense matrix on CPU"));
+        Mth::Matrix kd;
+        Mth::Vector fd(n), ud(n);
+        for(int c=0; c<nRhs; c++)
+        {
+            QString log;
+            k.toDense(kd);
+            for(int i=0; i<n; i++)
+                fd(i) = f[size_t(c)*n+i];
+            kd.solve_symmetric(fd, ud, log); // solve dense on CPU
+            MsgLog::information(log);
+            for(int i=0; i<n; i++)
+                x[size_t(c)*n+i] = ud(i);
+        }
+    }
+}
+
+
+bool LinearSolver::factorizeCholesky(const SparseMatrix &k, const DofMap &dofs, bool isSinglePrecision)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    std::vector<int> blockptr;
+    dofs.nodeBlocks(blockptr);
+    if(cholesky == nullptr)
+        cholesky = new SparseCholesky;
+
+    cholesky->isSinglePrecision = isSinglePrecision;
+    bool isFactorized = cholesky->factorize(k, blockptr);
+    if(!isFactorized && isSinglePrecision)
+    {
+        MsgLog::information(QString("Single precision factorization broke down, factorizing in double precision"));
+        cholesky->isSinglePrecision = false;
+        isFactorized = cholesky->factorize(k, blockptr);
+    }
+
+    if(!isFactorized)
+    {
+        MsgLog::error(QString("Stiffness matrix is not positive definite (equation %1), check the restrictions")
+                      .arg(cholesky->failedEquation));
+        clearFactorization();
+        return false;
+    }
+
+    size_t bytes = cholesky->isSinglePrecision? sizeof(float) : sizeof(double);
+    MsgLog::information(QString("Nested dissection and factorization in %1 s (%2 supernodes, %3 nonzeros, %4 MB)")
+                        .arg(timer.elapsed()/1000.).arg(cholesky->nSupernodes()).arg(cholesky->nnz())
+                        .arg(cholesky->nnz()*bytes/1048576.));
+    return true;
+}
+
+
+bool LinearSolver::refineSolution(const SparseMatrix &k, const std::vector<double> &f, std::vector<double> &x, int nRhs)
+{
+    // x += L^-t*L^-1*(f - k*x): the factor is float, the residual double,
+    // so x converges to the double precision solution while cond(k) is
+    // well below 1/eps of float; stops once the residual stalls
+    const int n = k.n;
+    std::vector<double> r(size_t(n)*nRhs), dx(size_t(n)*nRhs);
+    std::vector<double> fnorm(nRhs, 0.0);
+    for(int c=0; c<nRhs; c++)
+    {
+        for(int i=0; i<n; i++)
+            fnorm[c] += f[size_t(c)*n+i]*f[size_t(c)*n+i];
+        fnorm[c] = fnorm[c]>0.0? sqrt(fnorm[c]) : 1.0;
+    }
+
+    cholesky->solve(f.data(), x.data(), nRhs);
+
+    double residual = 0.0, previous = 0.0;
+    int step = 0;
+    for(;; step++)
+    {
+        residual = 0.0;
+        for(int c=0; c<nRhs; c++)
+        {
+            double *rc = r.data()+size_t(c)*n;
+            const double *fc = f.data()+size_t(c)*n;
+            k.multiply(x.data()+size_t(c)*n, rc);
+
+            double norm = 0.0;
+#pragma omp parallel for reduction(+:norm)
+            for(int i=0; i<n; i++)
+            {
+                rc[i] = fc[i]-rc[i];
+                norm += rc[i]*rc[i];
+            }
+            residual = std::max(residual, sqrt(norm)/fnorm[c]);
+        }
+
+        if(step>0 && residual >= REFINEMENT_MIN_REDUCTION*previous)
+            break;
+        if(step == REFINEMENT_MAX_STEPS)
+            break;
+
+        previous = residual;
+        cholesky->solve(r.data(), dx.data(), nRhs);
+#pragma omp parallel for
+        for(long long i=0; i<(long long)(n)*nRhs; i++)
+            x[i] += dx[i];
+    }
+
+    MsgLog::information(QString("Iterative refinement: %1 steps, residual %2").arg(step).arg(residual));
+    return residual <= tolerance;
+}
+
+
+void LinearSolver::solveIterative(const LinearOperator &k, const DofMap &dofs, const std::vector<double> &f,
+                                  std::vector<double> &x)
+{
+    // a matrix-free operator has no key and is never reused
+    unsigned long long key = cacheKey(k, preconditioning);
+    if(preconditioner && key!=0 && key==factorizationKey)
+        MsgLog::information(QString("Stiffness matrix unchanged, %1 preconditioner reused").arg(preconditionerName));
+    else
+    {
+        clearFactorization();
+        preconditioner = newPreconditioner(k, dofs, preconditionerName);
+        factorizationKey = key;
+    }
+    const QString &name = preconditionerName;
+
+    // previous solutions of another system are useless
+    if(!solutions.empty() && int(solutions.back().size())!=k.size())
+        solutions.clear();
+    bool isWarmStart = warmStartSize>0 && evalInitialGuess(k, f, x);
+
+    PCGSolver pcg;
+    pcg.tolerance = tolerance;
+    pcg.maxIterations = maxIterations;
+
+    bool isConverged = pcg.solve(k, *preconditioner, f, x, isWarmStart);
+    if(key == 0)
+        clearFactorization();
+
+    if(isWarmStart)
+        MsgLog::information(QString("Warm start from %1 previous solutions, initial residual %2")
+                            .arg(solutions.size()).arg(pcg.history.front()));
+
+    if(warmStartSize > 0)
+    {
+        solutions.push_back(x);
+        if(int(solutions.size()) > warmStartSize)
+            solutions.erase(solutions.begin(), solutions.end()-warmStartSize);
+    }
+
+    // residual history, about ten samples plus the last iteration
+    int step = std::max(1, int(pcg.history.size())/10);
+    for(size_t i=step; i+1<pcg.history.size(); i+=step)
+        MsgLog::information(QString("PCG iteration %1: residual %2").arg(i).arg(pcg.history[i]));
+
+    if(isConverged)
+        MsgLog::information(QString("PCG (%1) converged in %2 iterations, residual %3")
+                            .arg(name).arg(pcg.iterations).arg(pcg.residual));
+    else
+        MsgLog::error(QString("PCG (%1) did not converge in %2 iterations, residual %3")
+                      .arg(name).arg(pcg.iterations).arg(pcg.residual));
+}
+
+
+bool LinearSolver::evalInitialGuess(const LinearOperator &k, const std::vector<double> &f, std::vector<double> &x) const
+{
+    // Galerkin projection on W = [previous solutions]: x = W*a with
+    // (Wt*k*W)*a = Wt*f, exact when f is a combination of the previous loads
+    // and never worse than zero in the energy norm
+    const int n = k.size(), m = int(solutions.size());
+    if(m == 0)
+        return false;
+
+    std::vector<double> kw(n), g(size_t(m)*m), h(m), a(m, 0.0);
+    for(int j=0; j<m; j++)
+    {
+        k.multiply(solutions[j].data(), kw.data());
+        for(int i=0; i<m; i++)
+            g[i*m+j] = dot(solutions[i], kw);
+        h[j] = dot(solutions[j], f);
+    }
+
+    // Cholesky of Wt*k*W, dropping solutions that depend on the previous ones
+    std::vector<bool> isUsed(m, false);
+    for(int j=0; j<m; j++)
+    {
+        double d = g[j*m+j];
+        for(int p=0; p<j; p++)
+            if(isUsed[p])
+                d -= g[j*m+p]*g[j*m+p];
+        if(!(d > 1.e-12*g[j*m+j]))
+            continue;
+
+        isUsed[j] = true;
+        g[j*m+j] = sqrt(d);
+        for(int i=j+1; i<m; i++)
+        {
+            double s = g[i*m+j];
+            for(int p=0; p<j; p++)
+                if(isUsed[p])
+                    s -= g[i*m+p]*g[j*m+p];
+            g[i*m+j] = s/g[j*m+j];
+        }
+    }
+
+    for(int j=0; j<m; j++)
+        if(isUsed[j])
+        {
+            a[j] = h[j];
+            for(int p=0; p<j; p++)
+                if(isUsed[p])
+                    a[j] -= g[j*m+p]*a[p];
+            a[j] /= g[j*m+j];
+        }
+    for(int j=m-1; j>=0; j--)
+        if(isUsed[j])
+        {
+            for(int i=j+1; i<m; i++)
+                if(isUsed[i])
+                    a[j] -= g[i*m+j]*a[i];
+            a[j] /= g[j*m+j];
+        }
+
+    x.assign(n, 0.0);
+    for(int j=0; j<m; j++)
+        if(isUsed[j])
+        {
+#pragma omp parallel for schedule(static)
+            for(int i=0; i<n; i++)
+                x[i] += a[j]*solutions[j][i];
+        }
+
+    return true;
+}
+
+
+Preconditioner *LinearSolver::newPreconditioner(const LinearOperator &k, const DofMap &dofs, QString &name)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if(preconditioning == incompleteCholesky)
+    {
+        // the factorization needs the assembled matrix
+        const SparseMatrix *a = dynamic_cast<const SparseMatrix*>(&k);
+        if(a)
+        {
+            IncompleteCholeskyPreconditioner *ic = new IncompleteCholeskyPreconditioner(*a, dropTolerance, fill);
+            name = dropTolerance>0.0? "ICT" : "IC(0)";
+            if(ic->isFactorized)
+            {
+                MsgLog::information(QString("%1 factorization in %2 s (%3 nonzeros, shift %4, %5 levels)")
+                                    .arg(name).arg(timer.elapsed()/1000.).arg(ic->nnz()).arg(ic->shift).arg(ic->nLevels()));
+                return ic;
+            }
+
+            MsgLog::information(QString("%1 factorization broke down up to shift %2, block Jacobi used instead")
+                                .arg(name).arg(ic->shift));
+            delete ic;
+        }
+        else
+            MsgLog::information(QString("Incomplete Cholesky needs an assembled matrix, block Jacobi used instead"));
+    }
+
+    if(preconditioning == smoothedAggregation)
+    {
+        const SparseMatrix *a = dynamic_cast<const SparseMatrix*>(&k);
+        int nNullspace = a? int(nearNullspace.size())/a->n : 0;
+        if(a && nNullspace > 0)
+        {
+            std::vector<int> blockptr;
+            dofs.nodeBlocks(blockptr);
+            AMGPreconditioner *amg = new AMGPreconditioner(*a, blockptr, nearNullspace, nNullspace);
+            name = "AMG";
+
+            QString sizes;
+            for(int l=0; l<amg->nLevels(); l++)
+                sizes += QString(l? ", %1" : "%1").arg(amg->size(l));
+            MsgLog::information(QString("AMG setup in %1 s (%2 levels: %3 equations, operator complexity %4)")
+                                .arg(timer.elapsed()/1000.).arg(amg->nLevels()).arg(sizes).arg(amg->complexity()));
+            return amg;
+        }
+
+        MsgLog::information(QString("Smoothed aggregation needs an assembled matrix and its near-nullspace, block Jacobi used instead"));
+    }
+
+    if(preconditioning == jacobi)
+    {
+        name = "Jacobi";
+        return new JacobiPreconditioner(k);
+    }
+
+    std::vector<int> blockptr;
+    dofs.nodeBlocks(blockptr);
+    name = "block Jacobi";
+    return new BlockJacobiPreconditioner(k, blockptr);
+}
@@ -0,0 +1,99 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef LINEARSOLVER_H
+#define LINEARSOLVER_H
+
+#include "sparsematrix.h"
+#include "dofmap.h"
+#include "pcgsolver.h"
+#include "sparsecholesky.h"
+#include "skylinesolver.h"
+
+#include <vector>
+#include <QString>
+
+///
+/// \brief The LinearSolver class
+/// Solves the reduced system k*x = f of a mesh, with a direct solver
+/// (sparse Cholesky, skyline or dense) or the CPU preconditioned conjugate
+/// gradient, and reports the solution through MsgLog. The mixed precision
+/// Cholesky factorizes in float and refines the solution against k in
+/// double, falling back to a double factor if the refinement stalls. The last
+/// factorization (or preconditioner) is kept with a hash of k and the
+/// solver settings: solving again with the same constrained stiffness,
+/// e.g. for other loads, is only the triangular solves.
+///
+class LinearSolver
+{
+public:
+    enum Direct { dense, sparseCholesky, skyline, mixedCholesky };
+    enum Preconditioning { jacobi, blockJacobi, incompleteCholesky, smoothedAggregation };
+
+    Direct direct;
+    Preconditioning preconditioning;
+    double tolerance;  // on |r|/|b|
+    int maxIterations; // -1: 10 times the number of equations
+
+    // incomplete Cholesky: ICT keeping fill entries per row beyond the
+    // pattern of k, IC(0) with dropTolerance = 0
+    double dropTolerance;
+    int fill;
+
+    // smoothed aggregation: near-nullspace of k, columns of nFree rows
+    // (the rigid-body modes of solids), set by the mesh before solving
+    std::vector<double> nearNullspace;
+
+    // warm start of the iterative solves: the initial guess minimizes the
+    // energy norm of the error over the last warmStartSize solutions
+    // (kept with the factorization cache), 0 starts from zero
+    int warmStartSize;
+
+    LinearSolver();
+    ~LinearSolver();
+
+    // owns the cached factorization: moved between meshes only with
+    // adoptFactorization
+    LinearSolver(const LinearSolver &) = delete;
+    LinearSolver &operator=(const LinearSolver &) = delete;
+
+    // f and x: nRhs columns of k.n values
+    void solve(const SparseMatrix &k, const DofMap &dofs, const std::vector<double> &f,
+               std::vector<double> &x, bool isIterative, int nRhs = 1);
+    void solveIterative(const LinearOperator &k, const DofMap &dofs, const std::vector<double> &f,
+                        std::vector<double> &x);
+
+    void adoptFactorization(LinearSolver &solver); // cache and solutions of the previous mesh
+    void clearFactorization(void);
+
+private:
+    unsigned long long factorizationKey; // 0: nothing cached
+    SparseCholesky *cholesky;
+    SkylineSolver *skylineFactor;
+    Preconditioner *preconditioner;
+    QString preconditionerName;
+    std::vector< std::vector<double> > solutions; // previous solutions, newest last
+
+    unsigned long long cacheKey(const LinearOperator &k, int method) const;
+
+    bool factorizeCholesky(const SparseMatrix &k, const DofMap &dofs, bool isSinglePrecision);
+    bool refineSolution(const SparseMatrix &k, const std::vector<double> &f, std::vector<double> &x, int nRhs);
+
+    Preconditioner *newPreconditioner(const LinearOperator &k, const DofMap &dofs, QString &name);
+    bool evalInitialGuess(const LinearOperator &k, const std::vector<double> &f, std::vector<double> &x) const;
+};
+
+#endif // LINEARSOLVER_H
@@ -109,6 +109,11 @@ MainWindow::MainWindow(QWidget *parent) :
 
     connect(ui->action_Solver_2, SIGNAL(triggered(bool)), this, SLOT(iterative_solver()));
     connect(ui->action_Solver_3, SIGNAL(triggered(bool)), this, SLOT(direct_solver()));
+    connect(ui->action_Solver_4, SIGNAL(triggered(bool)), this, SLOT(matrixfree_solver()));
+    connect(ui->action_Solver_5, SIGNAL(triggered(bool)), this, SLOT(dense_solver()));
+    connect(ui->action_Solver_6, SIGNAL(triggered(bool)), this, SLOT(skyline_solver()));
+    connect(ui->action_Solver_7, SIGNAL(triggered(bool)), this, SLOT(mixed_solver()));
+    connect(ui->action_Solver_8, SIGNAL(triggered(bool)), this, SLOT(automatic_solver()));
 
 
     // setup output widget for MsgLog
@@ -125,6 +130,10 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->cutter_nz, SIGNAL(editingFinished()), this, SLOT(updateCutter()));
     connect(ui->cutter_position, SIGNAL(valueChanged(int)), this, SLOT(updateCutter()));
 
+    // the tree of a CDB model is built on demand; queued, since the tree is
+    // cleared while it is being expanded
+    connect(ui->treeWidget, SIGNAL(itemExpanded(QTreeWidgetItem*)), this, SLOT(expandTree()), Qt::QueuedConnection);
+
 
     t3d_fileManager = new Truss3DFileManager(ui->treeWidget);
     s3d_fileManager = new Solid3DFileManager(ui->treeWidget);
@@ -143,6 +152,9 @@ MainWindow::MainWindow(QWidget *parent) :
     QDir::setCurrent("../FEA_MNE772/models");
 
     isIterativeSolver = true;
+    isMatrixFree = false;
+    isAutomaticSolver = false;
+    directSolver = LinearSolver::sparseCholesky;
     updateParameters();
 
 }
@@ -196,7 +208,10 @@ void MainWindow::openFile(void)
         this->setWindowTitle(QString("Solid 3D Model [%1]").arg(s3d_fileManager->currentfilename));
 
         Solid3DReader reader(s3d_mesh);
-        s3d_mesh = reader.read(s3d_fileManager);
+        Solid3D *mesh = reader.read(s3d_fileManager);
+        if(mesh == nullptr)
+            return;
+        s3d_mesh = mesh;
 
         MsgLog::information("Solid 3D Model loaded");
         MsgLog::result(QString("%1 nodes, %2 elements").arg(s3d_mesh->nNodes).arg(s3d_mesh->nElements));
@@ -287,6 +302,9 @@ void MainWindow::solver(void)
 
             MsgLog::information(QString("Starting the Truss3D Solver"));
 
+            t3d_mesh->isIterativeSolver = isIterativeSolver;
+            t3d_mesh->solver.direct = directSolver;
+            setSolverParameters(t3d_mesh->solver);
             t3d_mesh->evalStiffnessMatrix();
             t3d_mesh->solve();
             //t3d_mesh->solve_simulation(wgl->nFrames);
@@ -305,10 +323,14 @@ void MainWindow::solver(void)
     else
     {
         if(s3d_fileManager->currentfilename == "") return;
-        s3d_fileManager->saveFile();
+        if(s3d_fileManager->isTreeBuilt)
+            s3d_fileManager->saveFile();
 
         Solid3DReader reader(s3d_mesh);
-        s3d_mesh = reader.read(s3d_fileManager);
+        Solid3D *mesh = reader.read(s3d_fileManager);
+        if(mesh == nullptr)
+            return;
+        s3d_mesh = mesh;
 
         QString str;
         QElapsedTimer timer;
@@ -323,11 +345,20 @@ void MainWindow::solver(void)
 
             MsgLog::information(QString("Starting the Solid3D Solver"));
 
+            if(isAutomaticSolver)
+                s3d_mesh->planSolver();
+            else
+            {
+                s3d_mesh->isMatrixFree = isMatrixFree;
+                s3d_mesh->isIterativeSolver = isIterativeSolver;
+                s3d_mesh->solver.direct = directSolver;
+            }
+            setSolverParameters(s3d_mesh->solver);
+
             s3d_mesh->evalStiffnessMatrix();
             s3d_mesh->evalLoadVector();
             //s3d_mesh->evalLoadVector();
 
-            s3d_mesh->isIterativeSolver = isIterativeSolver;
             s3d_mesh->solve();
             //s3d_mesh->solve_simulation(wgl->nFrames);
             s3d_mesh->isSolved = true;
@@ -492,21 +523,87 @@ void MainWindow::paintEvent(QPaintEvent *event)
 void MainWindow::direct_solver(void)
 {
     isIterativeSolver = false;
+    isMatrixFree = false;
+    isAutomaticSolver = false;
+    directSolver = LinearSolver::sparseCholesky;
     solver();
 }
 
 void MainWindow::iterative_solver(void)
 {
     isIterativeSolver = true;
+    isMatrixFree = false;
+    isAutomaticSolver = false;
+    solver();
+}
+
+void MainWindow::matrixfree_solver(void)
+{
+    isIterativeSolver = true;
+    isMatrixFree = true;
+    isAutomaticSolver = false;
     solver();
 }
 
+void MainWindow::dense_solver(void)
+{
+    isIterativeSolver = false;
+    isMatrixFree = false;
+    isAutomaticSolver = false;
+    directSolver = LinearSolver::dense;
+    solver();
+}
+
+void MainWindow::skyline_solver(void)
+{
+    isIterativeSolver = false;
+    isMatrixFree = false;
+    isAutomaticSolver = false;
+    directSolver = LinearSolver::skyline;
+    solver();
+}
+
+void MainWindow::mixed_solver(void)
+{
+    isIterativeSolver = false;
+    isMatrixFree = false;
+    isAutomaticSolver = false;
+    directSolver = LinearSolver::mixedCholesky;
+    solver();
+}
+
+void MainWindow::automatic_solver(void)
+{
+    isAutomaticSolver = true;
+    directSolver = LinearSolver::sparseCholesky;
+    solver();
+}
+
+void MainWindow::setSolverParameters(LinearSolver &solver)
+{
+    // Solver tab: PCG tolerance on |r|/|b| and maximum iterations (-1: auto)
+    bool ok;
+    double tolerance = ui->solver_tolerance->text().toDouble(&ok);
+    if(ok && tolerance > 0.0)
+        solver.tolerance = tolerance;
+    else
+        MsgLog::error(QString("Invalid PCG tolerance %1, %2 used").arg(ui->solver_tolerance->text()).arg(solver.tolerance));
+
+    solver.maxIterations = ui->solver_maxIterations->value();
+}
+
 void MainWindow::updateCutter(void)
 {
     updateParameters();
     vtkRenderer->planeCutter();
 }
 
+void MainWindow::expandTree(void)
+{
+    if(model == solid3d && !s3d_fileManager->isTreeBuilt)
+        s3d_fileManager->buildTree();
+}
+
 void MainWindow::keyPressEvent(QKeyEvent *event)
 {
     if(event->key() == Qt::Key_F5)
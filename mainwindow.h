@@ -62,6 +62,11 @@ public:
     vtkGraphicWindow *vtkRenderer;
 
     bool isIterativeSolver;
+    bool isMatrixFree;
+    bool isAutomaticSolver;
+    LinearSolver::Direct directSolver;
+
+    void setSolverParameters(LinearSolver &solver); // from the Solver tab
 
     ~MainWindow();
 
@@ -80,8 +85,14 @@ public slots:
 
     virtual void direct_solver(void);
     virtual void iterative_solver(void);
+    virtual void matrixfree_solver(void);
+    virtual void dense_solver(void);
+    virtual void skyline_solver(void);
+    virtual void mixed_solver(void);
+    virtual void automatic_solver(void);
 
     virtual void updateCutter(void);
+    virtual void expandTree(void);
 
 
 private:
@@ -18,7 +18,11 @@
 
 Node3D::Node3D()
 {
-
+    index = -1;
+    coordinates = nullptr;
+    restrictions = nullptr;
+    loading = nullptr;
+    displacements = nullptr;
 }
 
 Node3D::Node3D(int index, double *coordinates_, bool *restrictions,
@@ -0,0 +1,118 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "pcgsolver.h"
+
+#include <cmath>
+
+static double dot(const std::vector<double> &a, const std::vector<double> &b)
+{
+    const int n = int(a.size());
+    double sum = 0.0;
+
+#pragma omp parallel for schedule(static) reduction(+:sum)
+    for(int i=0; i<n; i++)
+        sum += a[i]*b[i];
+
+    return sum;
+}
+
+
+PCGSolver::PCGSolver()
+{
+    tolerance = 1.e-10;
+    maxIterations = -1;
+    iterations = 0;
+    residual = 0.0;
+}
+
+
+bool PCGSolver::solve(const LinearOperator &a, const Preconditioner &m,
+                      const std::vector<double> &b, std::vector<double> &x, bool isWarmStart)
+{
+    const int n = a.size();
+
+    // rounding delays convergence beyond n steps on ill-conditioned systems
+    int maxit = maxIterations<0? 10*n : maxIterations;
+
+    std::vector<double> r(b), z(n), p(n), q(n);
+    if(!isWarmStart || int(x.size())!=n)
+        x.assign(n, 0.0);
+
+    iterations = 0;
+    residual = 0.0;
+    history.clear();
+
+    double bnorm = sqrt(dot(b, b));
+    if(bnorm == 0.0)
+    {
+        x.assign(n, 0.0);
+        return true;
+    }
+
+    // r = b - a*x
+    residual = 1.0;
+    if(isWarmStart)
+    {
+        a.multiply(x.data(), q.data());
+#pragma omp parallel for schedule(static)
+        for(int i=0; i<n; i++)
+            r[i] -= q[i];
+        residual = sqrt(dot(r, r))/bnorm;
+    }
+
+    history.push_back(residual);
+    if(residual < tolerance)
+        return true;
+
+    m.apply(r.data(), z.data());
+    p = z;
+    double rz = dot(r, z);
+
+    for(iterations=1; iterations<=maxit; iterations++)
+    {
+        a.multiply(p.data(), q.data());
+
+        double alpha = rz/dot(p, q);
+        double rr = 0.0;
+
+#pragma omp parallel for schedule(static) reduction(+:rr)
+        for(int i=0; i<n; i++)
+        {
+            x[i] += alpha*p[i];
+            r[i] -= alpha*q[i];
+            rr += r[i]*r[i];
+        }
+
+        residual = sqrt(rr)/bnorm;
+        history.push_back(residual);
+        if(residual < tolerance)
+            return true;
+
+        m.apply(r.data(), z.data());
+
+        double rz_new = dot(r, z);
+        double beta = rz_new/rz;
+        rz = rz_new;
+
+#pragma omp parallel for schedule(static)
+        for(int i=0; i<n; i++)
+            p[i] = z[i] + beta*p[i];
+    }
+
+    iterations = maxit;
+    return false;
+}
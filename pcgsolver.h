@@ -0,0 +1,47 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef PCGSOLVER_H
+#define PCGSOLVER_H
+
+#include "linearoperator.h"
+#include "preconditioner.h"
+
+#include <vector>
+
+///
+/// \brief The PCGSolver class
+/// Preconditioned conjugate gradient for symmetric positive definite
+/// operators. Vector updates and dot products run on all OpenMP threads.
+///
+class PCGSolver
+{
+public:
+    double tolerance;  // on |r|/|b|
+    int maxIterations; // -1: 10 times the number of equations
+
+    int iterations;
+    double residual;
+    std::vector<double> history; // relative residual of each iteration
+
+    PCGSolver();
+
+    // x is the initial guess if isWarmStart, zero otherwise
+    bool solve(const LinearOperator &a, const Preconditioner &m,
+               const std::vector<double> &b, std::vector<double> &x, bool isWarmStart = false);
+};
+
+#endif // PCGSOLVER_H
@@ -0,0 +1,103 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "preconditioner.h"
+
+#include <cstddef>
+
+JacobiPreconditioner::JacobiPreconditioner(const LinearOperator &a)
+{
+    const int n = a.size();
+    dinv.resize(n);
+    a.diagonal(dinv.data());
+
+    for(int i=0; i<n; i++)
+        dinv[i] = dinv[i]!=0.0? 1.0/dinv[i] : 1.0;
+}
+
+
+void JacobiPreconditioner::apply(const double *r, double *z) const
+{
+    const int n = int(dinv.size());
+
+#pragma omp parallel for schedule(static)
+    for(int i=0; i<n; i++)
+        z[i] = dinv[i]*r[i];
+}
+
+
+BlockJacobiPreconditioner::BlockJacobiPreconditioner(const LinearOperator &a, const std::vector<int> &blockptr)
+{
+    this->blockptr = blockptr;
+    const int nBlocks = int(blockptr.size())-1;
+
+    blocks.assign(9*size_t(nBlocks), 0.0);
+    a.diagonalBlocks(blockptr.data(), nBlocks, blocks.data());
+
+#pragma omp parallel for schedule(static)
+    for(int k=0; k<nBlocks; k++)
+    {
+        double *b = &blocks[9*size_t(k)];
+        int s = blockptr[k+1]-blockptr[k];
+
+        // unused rows and columns of a smaller block act as identity
+        for(int i=s; i<3; i++)
+            b[3*i+i] = 1.0;
+
+        double inv[9];
+        inv[0] = b[4]*b[8]-b[5]*b[7];
+        inv[1] = b[2]*b[7]-b[1]*b[8];
+        inv[2] = b[1]*b[5]-b[2]*b[4];
+        inv[3] = b[5]*b[6]-b[3]*b[8];
+        inv[4] = b[0]*b[8]-b[2]*b[6];
+        inv[5] = b[2]*b[3]-b[0]*b[5];
+        inv[6] = b[3]*b[7]-b[4]*b[6];
+        inv[7] = b[1]*b[6]-b[0]*b[7];
+        inv[8] = b[0]*b[4]-b[1]*b[3];
+
+        double det = b[0]*inv[0] + b[1]*inv[3] + b[2]*inv[6];
+
+        if(det != 0.0)
+            for(int t=0; t<9; t++)
+                b[t] = inv[t]/det;
+        else // singular block: fall back to the diagonal
+            for(int i=0; i<3; i++)
+                for(int j=0; j<3; j++)
+                    b[3*i+j] = i!=j? 0.0 : (b[3*i+i]!=0.0? 1.0/b[3*i+i] : 1.0);
+    }
+}
+
+
+void BlockJacobiPreconditioner::apply(const double *r, double *z) const
+{
+    const int nBlocks = int(blockptr.size())-1;
+
+#pragma omp parallel for schedule(static)
+    for(int k=0; k<nBlocks; k++)
+    {
+        const double *b = &blocks[9*size_t(k)];
+        int p = blockptr[k];
+        int s = blockptr[k+1]-p;
+
+        for(int i=0; i<s; i++)
+        {
+            double sum = 0.0;
+            for(int j=0; j<s; j++)
+                sum += b[3*i+j]*r[p+j];
+            z[p+i] = sum;
+        }
+    }
+}
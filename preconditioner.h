@@ -0,0 +1,67 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef PRECONDITIONER_H
+#define PRECONDITIONER_H
+
+#include "linearoperator.h"
+
+#include <vector>
+
+///
+/// \brief The Preconditioner class
+/// Approximate inverse z = M^-1 * r applied at each PCG iteration.
+///
+class Preconditioner
+{
+public:
+    virtual ~Preconditioner() {}
+    virtual void apply(const double *r, double *z) const = 0;
+};
+
+
+///
+/// \brief The JacobiPreconditioner class
+/// Inverse of the diagonal of the operator.
+///
+class JacobiPreconditioner : public Preconditioner
+{
+public:
+    JacobiPreconditioner(const LinearOperator &a);
+    void apply(const double *r, double *z) const;
+
+private:
+    std::vector<double> dinv;
+};
+
+
+///
+/// \brief The BlockJacobiPreconditioner class
+/// Inverse of the nodal diagonal blocks of the operator: up to 3x3, one
+/// block per node with the free dofs of that node.
+///
+class BlockJacobiPreconditioner : public Preconditioner
+{
+public:
+    BlockJacobiPreconditioner(const LinearOperator &a, const std::vector<int> &blockptr);
+    void apply(const double *r, double *z) const;
+
+private:
+    std::vector<int> blockptr;
+    std::vector<double> blocks; // 3x3 inverse of each block, row by row
+};
+
+#endif // PRECONDITIONER_H
@@ -0,0 +1,164 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "principalstress.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// unit vector normal to the rows a and b of S - s*I: the largest of the
+// three cross products of the rows, false if the rows have rank < 2
+static bool nullVector(const double S[3][3], double s, double *v)
+{
+    double r[3][3];
+    for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+            r[i][j] = S[i][j] - (i==j? s : 0.0);
+
+    double best = 0.0;
+    for(int a=0; a<3; a++)
+    {
+        const double *p = r[a], *q = r[(a+1)%3];
+        double c[3] = {p[1]*q[2]-p[2]*q[1], p[2]*q[0]-p[0]*q[2], p[0]*q[1]-p[1]*q[0]};
+        double norm = c[0]*c[0] + c[1]*c[1] + c[2]*c[2];
+        if(norm > best)
+        {
+            best = norm;
+            v[0] = c[0]; v[1] = c[1]; v[2] = c[2];
+        }
+    }
+
+    double scale = 0.0;
+    for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+            scale = std::max(scale, fabs(r[i][j]));
+    if(!(best > 1.e-24*scale*scale*scale*scale))
+        return false;
+
+    best = sqrt(best);
+    for(int i=0; i<3; i++)
+        v[i] /= best;
+    return true;
+}
+
+
+static void principalDirections(const double S[3][3], const double *s, double *v)
+{
+    // the most isolated value first (well defined), the other two in the
+    // plane normal to it by the closed form 2x2 rotation
+    int first = s[0]-s[1] >= s[1]-s[2]? 0 : 2;
+    double *va = v+3*first;
+    if(!nullVector(S, s[first], va))
+    {
+        // isotropic tensor: any basis
+        for(int i=0; i<9; i++)
+            v[i] = i%4==0? 1.0 : 0.0;
+        return;
+    }
+
+    // basis (b, c) of the plane normal to va
+    double b[3], c[3];
+    int k = fabs(va[0]) < fabs(va[1])? (fabs(va[0]) < fabs(va[2])? 0 : 2) : (fabs(va[1]) < fabs(va[2])? 1 : 2);
+    double e[3] = {0.0, 0.0, 0.0};
+    e[k] = 1.0;
+    b[0] = va[1]*e[2]-va[2]*e[1];
+    b[1] = va[2]*e[0]-va[0]*e[2];
+    b[2] = va[0]*e[1]-va[1]*e[0];
+    double norm = sqrt(b[0]*b[0] + b[1]*b[1] + b[2]*b[2]);
+    for(int i=0; i<3; i++)
+        b[i] /= norm;
+    c[0] = va[1]*b[2]-va[2]*b[1];
+    c[1] = va[2]*b[0]-va[0]*b[2];
+    c[2] = va[0]*b[1]-va[1]*b[0];
+
+    double Sb[3], Sc[3];
+    for(int i=0; i<3; i++)
+    {
+        Sb[i] = S[i][0]*b[0] + S[i][1]*b[1] + S[i][2]*b[2];
+        Sc[i] = S[i][0]*c[0] + S[i][1]*c[1] + S[i][2]*c[2];
+    }
+    double mbb = b[0]*Sb[0] + b[1]*Sb[1] + b[2]*Sb[2];
+    double mcc = c[0]*Sc[0] + c[1]*Sc[1] + c[2]*Sc[2];
+    double mbc = b[0]*Sc[0] + b[1]*Sc[1] + b[2]*Sc[2];
+
+    // rotation of (b, c) that diagonalizes the 2x2 block, larger value first
+    double theta = 0.5*atan2(2.0*mbc, mbb-mcc);
+    double ct = cos(theta), st = sin(theta);
+    double *vmax = v+3*(first==0? 1 : 0), *vmin = v+3*(first==0? 2 : 1);
+    for(int i=0; i<3; i++)
+    {
+        vmax[i] = ct*b[i] + st*c[i];
+        vmin[i] = -st*b[i] + ct*c[i];
+    }
+}
+
+
+void evalPrincipalStresses(int n, const double *sxx, const double *syy, const double *szz,
+                           const double *sxy, const double *syz, const double *szx,
+                           double *s1, double *s2, double *s3, double *directions)
+{
+    const double third = 1.0/3.0, sqrt3 = 1.7320508075688772;
+
+    // S = q*I + p*B with tr(B) = 0, |B|^2 = 6: the roots are
+    // q + 2p*cos(phi + 2k*pi/3), phi = acos(r)/3, r = det(B)/2. c = cos(phi)
+    // is the root of 4c^3 - 3c = r in [1/2, 1], found by Newton from a fit
+    // in h = cos(3*phi/2) (exact at r = -1, 0, 1), so that the loop has no
+    // calls to acos and cos and is vectorized
+#pragma omp parallel for simd schedule(static)
+    for(int i=0; i<n; i++)
+    {
+        double q = (sxx[i] + syy[i] + szz[i])*third;
+        double a = sxx[i]-q, b = syy[i]-q, c = szz[i]-q;
+        double d = sxy[i], e = syz[i], f = szx[i];
+
+        double p2 = (a*a + b*b + c*c + 2.0*(d*d + e*e + f*f))/6.0;
+        double p = sqrt(p2);
+        double scale = p>0.0? 1.0/p : 0.0;
+
+        // det(B)/2, clamped against rounding
+        double r = 0.5*scale*scale*scale*(a*(b*c-e*e) - d*(d*c-e*f) + f*(d*e-b*f));
+        r = r<-1.0? -1.0 : (r>1.0? 1.0 : r);
+
+        double h = sqrt(0.5*(1.0+r));
+        double x = 0.5 + h*(0.5773502691896258 + h*(-0.1016 + 0.0242*h));
+        x -= ((4.0*x*x - 3.0)*x - r)/fmax(12.0*x*x - 3.0, 1.e-300);
+        x -= ((4.0*x*x - 3.0)*x - r)/fmax(12.0*x*x - 3.0, 1.e-300);
+        x -= ((4.0*x*x - 3.0)*x - r)/fmax(12.0*x*x - 3.0, 1.e-300);
+        x = x<1.0? x : 1.0;
+        double y = sqrt(1.0 - x*x); // sin(phi)
+
+        double w1 = q + 2.0*p*x;
+        double w2 = q - p*(x - sqrt3*y);
+        double w3 = q - p*(x + sqrt3*y);
+        s1[i] = w1;
+        s2[i] = w2>w1? w1 : (w2<w3? w3 : w2);
+        s3[i] = w3;
+    }
+
+    if(directions == nullptr)
+        return;
+
+#pragma omp parallel for schedule(static)
+    for(int i=0; i<n; i++)
+    {
+        const double S[3][3] = { {sxx[i], sxy[i], szx[i]},
+                                 {sxy[i], syy[i], syz[i]},
+                                 {szx[i], syz[i], szz[i]} };
+        const double s[3] = {s1[i], s2[i], s3[i]};
+        principalDirections(S, s, directions+9*size_t(i));
+    }
+}
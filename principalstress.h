@@ -0,0 +1,33 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef PRINCIPALSTRESS_H
+#define PRINCIPALSTRESS_H
+
+///
+/// \brief evalPrincipalStresses
+/// Principal values s1 >= s2 >= s3 of n symmetric 3x3 stress tensors given
+/// by component arrays (structure of arrays), in closed form: the roots of
+/// the characteristic cubic by the trigonometric (Cardano) solution, in a
+/// vectorized loop. If directions is not null it receives 9 values per
+/// tensor, the unit direction of s1, s2 and s3 one after the other, as the
+/// eigenvector columns of vtkMath::Jacobi.
+///
+void evalPrincipalStresses(int n, const double *sxx, const double *syy, const double *szz,
+                           const double *sxy, const double *syz, const double *szx,
+                           double *s1, double *s2, double *s3, double *directions = nullptr);
+
+#endif // PRINCIPALSTRESS_H
@@ -0,0 +1,65 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "rampresult.h"
+
+#include <algorithm>
+
+RampResult::RampResult()
+{
+    nRows = 0;
+    nColumns = 1;
+}
+
+
+void RampResult::setSteps(int nSteps)
+{
+    factors.resize(nSteps);
+    for(int k=0; k<nSteps; k++)
+        factors[k] = k*(1.0/nSteps);
+}
+
+
+void RampResult::setField(const std::vector<double> &values, int nColumns)
+{
+    this->values = values;
+    this->nColumns = nColumns;
+    nRows = int(values.size()/nColumns);
+}
+
+
+void RampResult::limits(int j, double &min, double &max) const
+{
+    min = max = 0.0;
+    if(nRows == 0 || factors.empty())
+        return;
+
+    // linear in the factor: the extremes are at the smallest and largest
+    // factors, times the extremes of the field
+    double vmin = values[j], vmax = values[j];
+    for(int i=1; i<nRows; i++)
+    {
+        double value = values[size_t(i)*nColumns+j];
+        if(value>vmax) vmax = value;
+        if(value<vmin) vmin = value;
+    }
+
+    double fmin = *std::min_element(factors.begin(), factors.end());
+    double fmax = *std::max_element(factors.begin(), factors.end());
+
+    min = std::min(std::min(fmin*vmin, fmin*vmax), std::min(fmax*vmin, fmax*vmax));
+    max = std::max(std::max(fmin*vmin, fmin*vmax), std::max(fmax*vmin, fmax*vmax));
+}
@@ -0,0 +1,53 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef RAMPRESULT_H
+#define RAMPRESULT_H
+
+#include <cstddef>
+#include <vector>
+
+///
+/// \brief The RampResult class
+/// Result field of a linear load ramp. Step k is factors[k] times the field
+/// of the full load, so only that field (rows x columns, row major) and the
+/// load factors are stored and a step is evaluated on access: the memory is
+/// the same for any number of steps.
+///
+class RampResult
+{
+public:
+    std::vector<double> factors; // load factor of each step
+    std::vector<double> values;  // field of the full load
+    int nRows;
+    int nColumns;
+
+    RampResult();
+
+    void setSteps(int nSteps); // factors k/nSteps, k = 0 .. nSteps-1
+    void setField(const std::vector<double> &values, int nColumns = 1);
+
+    int steps(void) const { return int(factors.size()); }
+    double factor(int k) const { return factors[k]; }
+
+    // entry i (single column) or (i,j) of step k
+    double operator()(int i, int k) const { return factors[k]*values[i]; }
+    double operator()(int i, int j, int k) const { return factors[k]*values[size_t(i)*nColumns+j]; }
+
+    void limits(int j, double &min, double &max) const; // column j over all the steps
+};
+
+#endif // RAMPRESULT_H
@@ -0,0 +1,136 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "skylinesolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+SkylineSolver::SkylineSolver()
+{
+    n = 0;
+    failedEquation = -1;
+}
+
+
+void SkylineSolver::analyse(const SparseMatrix &a)
+{
+    n = a.n;
+    first.resize(n);
+    rowptr.assign(1, 0);
+
+    for(int i=0; i<n; i++)
+    {
+        first[i] = i;
+        if(a.rowptr[i+1] > a.rowptr[i])
+            first[i] = std::min(i, a.colind[a.rowptr[i]]); // columns are sorted
+        rowptr.push_back(rowptr.back() + i-first[i]+1);
+    }
+}
+
+
+bool SkylineSolver::factorize(const SparseMatrix &a)
+{
+    failedEquation = -1;
+    if(n != a.n || rowptr.empty())
+        analyse(a);
+
+    values.assign(rowptr[n], 0.0);
+    for(int i=0; i<n; i++)
+        for(int p=a.rowptr[i]; p<a.rowptr[i+1]; p++)
+            if(a.colind[p] <= i)
+                values[rowptr[i] + a.colind[p]-first[i]] = a.values[p];
+
+    // Crout, row by row: g_ij = a_ij - sum_k g_ik*l_jk, then l_ij = g_ij/d_j
+    for(int i=0; i<n; i++)
+    {
+        double *ri = values.data() + rowptr[i] - first[i]; // ri[j] = row i, column j
+
+        for(int j=first[i]; j<i; j++)
+        {
+            const double *rj = values.data() + rowptr[j] - first[j];
+            int k0 = std::max(first[i], first[j]);
+            double sum = 0.0;
+#pragma omp simd reduction(+:sum)
+            for(int k=k0; k<j; k++)
+                sum += ri[k]*rj[k];
+            ri[j] -= sum;
+        }
+
+        double d = ri[i];
+        for(int j=first[i]; j<i; j++)
+        {
+            double g = ri[j];
+            ri[j] = g/values[rowptr[j+1]-1];
+            d -= g*ri[j];
+        }
+
+        // a vanishing pivot means a mechanism in the model
+        if(!(std::fabs(d) > 1.e-12*std::fabs(ri[i])))
+        {
+            failedEquation = i;
+            return false;
+        }
+        ri[i] = d;
+    }
+
+    return true;
+}
+
+
+void SkylineSolver::solve(const double *b, double *x, int nRhs) const
+{
+    for(int c=0; c<nRhs; c++, b+=n, x+=n)
+    {
+        // L*z = b
+        for(int i=0; i<n; i++)
+        {
+            const double *ri = values.data() + rowptr[i] - first[i];
+            double sum = b[i];
+            for(int j=first[i]; j<i; j++)
+                sum -= ri[j]*x[j];
+            x[i] = sum;
+        }
+
+        // D*y = z
+        for(int i=0; i<n; i++)
+            x[i] /= values[rowptr[i+1]-1];
+
+        // Lt*x = y, column by column of Lt
+        for(int i=n-1; i>=0; i--)
+        {
+            const double *ri = values.data() + rowptr[i] - first[i];
+            for(int j=first[i]; j<i; j++)
+                x[j] -= ri[j]*x[i];
+        }
+    }
+}
+
+
+long long SkylineSolver::profile(void) const
+{
+    return rowptr.empty()? 0 : rowptr[n];
+}
+
+
+int SkylineSolver::bandwidth(void) const
+{
+    int b = 0;
+    for(int i=0; i<n; i++)
+        b = std::max(b, i-first[i]);
+
+    return b;
+}
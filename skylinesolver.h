@@ -0,0 +1,51 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef SKYLINESOLVER_H
+#define SKYLINESOLVER_H
+
+#include "sparsematrix.h"
+
+#include <vector>
+
+///
+/// \brief The SkylineSolver class
+/// Direct solver A = L*D*Lt in profile (skyline) storage: row i keeps the
+/// entries from its first nonzero column up to the diagonal, so the fill
+/// stays inside the envelope of A. Memory is known before factorizing and
+/// is small when the equations are numbered to reduce the bandwidth.
+///
+class SkylineSolver
+{
+public:
+    SkylineSolver();
+
+    void analyse(const SparseMatrix &a); // envelope of the lower triangle
+    bool factorize(const SparseMatrix &a); // false if a pivot vanishes
+    void solve(const double *b, double *x, int nRhs = 1) const; // columns of n values
+
+    long long profile(void) const; // stored entries
+    int bandwidth(void) const;     // largest row length below the diagonal
+    int failedEquation;            // where the factorization broke down, -1 if none
+
+private:
+    int n;
+    std::vector<int> first;           // first column of each row
+    std::vector<long long> rowptr;    // row i: values[rowptr[i]] is column first[i], diagonal last
+    std::vector<double> values;       // L below the diagonal, D on the diagonal
+};
+
+#endif // SKYLINESOLVER_H
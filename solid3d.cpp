@@ -15,18 +15,26 @@
 ****************************************************************************/
 
 #include "solid3d.h"
+#include "tetrabatch.h"
+#include "solverplanner.h"
+#include "principalstress.h"
+#include "cdbtokenizer.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <istream>
 #include <string>
 #include <cmath>
 #include <QString>
-#include <QFile>
 #include <QStringList>
 #include <QElapsedTimer>
-#include <QTextStream>
-#include <vtkMath.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define NRV 14 // nodal results: stresses, von Mises, displacements, principal stresses
 
 #include <mth/matrix.h>
 
@@ -53,28 +61,37 @@ Solid3D::Solid3D()
 {
     nNodes = 0;
     nElements = 0;
+    nColors = 0;
+    nma = 0;
+    nodes = nullptr;
+    elements = nullptr;
+    materials = nullptr;
     isSolved = false;
     isMounted = false;
     isSolved_simulation = false;
     isIterativeSolver = true;
+    isMatrixFree = false;
+    solver.preconditioning = LinearSolver::smoothedAggregation;
 }
 
 
 Solid3D::Solid3D(QString filename)
 {
-    QFile file(filename);
-
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
-        std::cerr<<"error in opening file";
-
-    QTextStream text(&file);
-
-    QString line;
-    QStringList str;
-
+    nNodes = 0;
+    nElements = 0;
+    nColors = 0;
+    nma = 0;
+    nodes = nullptr;
+    elements = nullptr;
+    materials = nullptr;
     nre = 2;
     nlo = 2;
     ndi = 2;
+    pressure0 = 0.0;
+    pressure1 = 0.0;
+    isSolved = false;
+    isMounted = false;
+    isSolved_simulation = false;
 
     // default bondary condition
     restrictions = new bool*[nre];
@@ -102,27 +119,28 @@ Solid3D::Solid3D(QString filename)
     displacements[1] = new double[3];
     loading[1] = new double[3];
 
-    do {
-        line = text.readLine();
-        if(line.isNull())
-            break;
-        str = line.split(",", QString::SkipEmptyParts);
+    // an unreadable file leaves an empty mesh, Solid3DReader rejects it
+    CdbTokenizer tokens;
+    if(!tokens.open(filename.toStdString()))
+        MsgLog::error(QString("Cannot open file %1").arg(filename));
 
-        if(str[0]=="NUMOFF")
+    while(tokens.readLine())
+    {
+        if(tokens.is(0, "NUMOFF"))
         {
-            if(str[1]=="NODE")
+            if(tokens.is(1, "NODE"))
             {
-                nNodes = str[2].toInt();
-                nodes = new Node3D*[nNodes];
+                nNodes = tokens.toInt(2);
+                nodes = storage.allocateNodes(nNodes);
             }
-            else if(str[1]=="ELEM")
+            else if(tokens.is(1, "ELEM"))
             {
-                nElements = str[2].toInt();
-                elements = new Solid3DElement*[nElements];
+                nElements = tokens.toInt(2);
+                elements = storage.allocateElements(nElements);
             }
-            else if(str[1]=="MAT ")
+            else if(tokens.is(1, "MAT "))
             {
-                nma= str[2].toInt();
+                nma= tokens.toInt(2);
                 materials = new Material*[nma];
 
                 for(int i=0; i<nma; i++)
@@ -134,93 +152,83 @@ Solid3D::Solid3D(QString filename)
             }
         }
 
-        if(str[0]=="MP")
+        if(tokens.is(0, "MP"))
         {
             do {
-                int index = str[2].toInt()-1;
-
-                if(str[1]=="DENS")
-                    materials[index]->density = str[3].toDouble();
-                else if(str[1]=="EX")
-                    materials[index]->E = str[3].toDouble();
-                else if(str[1]=="PRXY")
-                    materials[index]->poisson = str[3].toDouble();
-
-                line = text.readLine();
-                str = line.split(",", QString::SkipEmptyParts);
-            }while(str[0]=="MP");
+                int index = tokens.toInt(2)-1;
+
+                if(tokens.is(1, "DENS"))
+                    materials[index]->density = tokens.toDouble(3);
+                else if(tokens.is(1, "EX"))
+                    materials[index]->E = tokens.toDouble(3);
+                else if(tokens.is(1, "PRXY"))
+                    materials[index]->poisson = tokens.toDouble(3);
+
+                tokens.readLine();
+            }while(tokens.is(0, "MP"));
         }
 
-        if(str[0]=="N")
+        if(tokens.is(0, "N"))
         {
             double coord[3];
             for(int i=0; i<nNodes; i++)
             {
-                if(str[0] != "N")
+                if(!tokens.is(0, "N"))
                     break;
-                if(str[3].toInt()-1 != i) std::cerr<<"error in nodes indexing";
-                coord[0] = str[4].toDouble();
-                coord[1] = str[5].toDouble();
-                coord[2] = str[6].toDouble();
+                if(tokens.toInt(3)-1 != i) std::cerr<<"error in nodes indexing";
+                coord[0] = tokens.toDouble(4);
+                coord[1] = tokens.toDouble(5);
+                coord[2] = tokens.toDouble(6);
 
-                nodes[i] = new Node3D(i, coord, restrictions[0],
-                        loading[0], displacements[0]);
+                storage.setNode(i, i, coord, restrictions[0], loading[0], displacements[0]);
 
-                line = text.readLine();
-                str = line.split(",", QString::SkipEmptyParts);
+                tokens.readLine();
             }
         }
 
-        if(str[0]=="EN")
+        if(tokens.is(0, "EN"))
         {
             int ima;
             for(int i=0; i<nElements+1; i++)
             {
-                str = line.split(",", QString::SkipEmptyParts);
-                if(str[0] != "EN")
+                if(!tokens.is(0, "EN"))
                     break;
-                //std::cout<<"\n:"<<i<<"<<<< "<<str[0].toStdString()<<" >>>>"<<line.toStdString();
-
-                ima = str[4].toInt()-1;
-                if(str[7].toInt()-1 != i) std::cerr<<"error in elementss indexing";
 
-                line = text.readLine();
-                str = line.split(",", QString::SkipEmptyParts);
+                // ATTR line, then NODE line
+                ima = tokens.toInt(4)-1;
+                if(tokens.toInt(7)-1 != i) std::cerr<<"error in elementss indexing";
 
-                elements[i] = new Solid3DElement(
-                            i,
-                            nodes[str[3].toInt()-1],
-                        nodes[str[4].toInt()-1],
-                        nodes[str[5].toInt()-1],
-                        nodes[str[6].toInt()-1],
-                        materials[ima]);
+                tokens.readLine();
 
-                line = text.readLine();
-                //str = line.split(",", QString::SkipEmptyParts);
+                storage.setElement(i, i,
+                                   nodes[tokens.toInt(3)-1],
+                                   nodes[tokens.toInt(4)-1],
+                                   nodes[tokens.toInt(5)-1],
+                                   nodes[tokens.toInt(6)-1],
+                                   materials, ima);
 
+                tokens.readLine();
             }
         }
 
 
-        if(str[0]=="SFE")
+        if(tokens.is(0, "SFE"))
         {
             int iel;
             do {
-                iel = str[1].toInt()-1;
-                elements[iel]->pface = str[2].toInt()-1;
-                line = text.readLine();
-                str = line.split(",", QString::SkipEmptyParts);
+                iel = tokens.toInt(1)-1;
+                elements[iel]->pface = tokens.toInt(2)-1;
+                tokens.readLine();
                 pressure0 = 0.0;
-                pressure1 = str[0].toDouble();
+                pressure1 = tokens.toDouble(0);
                 elements[iel]->pressure = &pressure1;
 
-                line = text.readLine();
-                str = line.split(",", QString::SkipEmptyParts);
-            }while(str[0]=="SFE");
+                tokens.readLine();
+            }while(tokens.is(0, "SFE"));
         }
 
 
-        if(str[0]=="D")
+        if(tokens.is(0, "D"))
         {
             //            restrictions[1] = new bool[3];
             //            displacements[1] = new double[3];
@@ -229,52 +237,284 @@ Solid3D::Solid3D(QString filename)
             restrictions[1][1] = true;
             restrictions[1][2] = true;
 
-            displacements[1][0] = str[3].toDouble();
+            displacements[1][0] = tokens.toDouble(3);
             displacements[1][1] = 0.0;
             displacements[1][2] = 0.0;
 
             int inode;
 
             do {
-                inode = str[1].toInt()-1;
+                inode = tokens.toInt(1)-1;
                 nodes[inode]->restrictions = restrictions[1];
                 nodes[inode]->displacements = displacements[1];
-                line = text.readLine();
-                if(line.isNull())
+                if(!tokens.readLine())
                     break;
-                str = line.split(",", QString::SkipEmptyParts);
-            }while(str[0]=="D");
+            }while(tokens.is(0, "D"));
         }
+    }
 
+    isIterativeSolver = true;
+    isMatrixFree = false;
+    solver.preconditioning = LinearSolver::smoothedAggregation;
+}
 
-    } while (!line.isNull());
 
-    isIterativeSolver = true;
+void Solid3D::evalConnectivity(void)
+{
+    connectivity = storage.connectivity;
 }
 
 
-void Solid3D::evalStiffnessMatrix(void)
+void Solid3D::evalStiffnessPattern(void)
 {
-    k.resize(3*nNodes, 3*nNodes);
-    k = 0.0;
+    evalConnectivity();
 
-    for(int i=0; i<nma; i++)
-        materials[i]->updateMatrixD();
+    // sparsity pattern of the free dofs from the element connectivity
+    const int *equation = dofs.equation.data();
+    k.setBlockPattern(nNodes, connectivity.data(), nElements, 4, equation);
 
-    // global stiffness matrix
-    Mth::Matrix ke(12,12);
+    // scatter map: position of each ke(3*i+ii, 3*j+jj) in k.values,
+    // -1 for the rows and columns of restricted dofs
+    scatter.resize(144*size_t(nElements));
 
-    //#pragma omp parallel for num_threads(FEM_NUM_THREADS)
     for(int iel=0; iel<nElements; iel++)
     {
-        elements[iel]->getStiffnessMatrix(ke);
+        int *map = &scatter[144*size_t(iel)];
+        const int *enodes = &connectivity[4*iel];
 
         for(int i=0; i<4; i++)
-            for(int j=0; j<4; j++)
-                for(int ii=0; ii<3; ii++)
+            for(int ii=0; ii<3; ii++)
+                for(int j=0; j<4; j++)
+                {
+                    int row = equation[3*enodes[i]+ii];
+                    int p = -1;
+
+                    // free columns of a nodal block are contiguous in the row
                     for(int jj=0; jj<3; jj++)
-                        k(3*elements[iel]->nodes[i]->index+ii, 3*elements[iel]->nodes[j]->index+jj) += ke(3*i+ii, 3*j+jj);
+                    {
+                        int col = equation[3*enodes[j]+jj];
+                        if(row<0 || col<0)
+                            map[12*(3*i+ii)+3*j+jj] = -1;
+                        else
+                        {
+                            p = p<0? k.find(row, col) : p+1;
+                            map[12*(3*i+ii)+3*j+jj] = p;
+                        }
+                    }
+                }
     }
+
+    evalElementColors();
+
+    MsgLog::information(QString("Sparse stiffness matrix: %1 free dof (%2 restricted), %3 nonzeros (%4 MB)")
+                        .arg(k.n).arg(dofs.nDofs-dofs.nFree).arg(k.nnz).arg(k.memory()));
+}
+
+
+void Solid3D::evalElementColors(void)
+{
+    // node -> elements adjacency
+    std::vector<int> nodeptr(nNodes+1, 0);
+    for(int t=0; t<4*nElements; t++)
+        nodeptr[connectivity[t]+1]++;
+    for(int i=0; i<nNodes; i++)
+        nodeptr[i+1] += nodeptr[i];
+
+    std::vector<int> nodeElements(4*nElements);
+    std::vector<int> fill(nodeptr.begin(), nodeptr.end()-1);
+    for(int t=0; t<4*nElements; t++)
+        nodeElements[fill[connectivity[t]]++] = t/4;
+
+    // greedy colouring: smallest colour not used by any neighbour element
+    std::vector<int> color(nElements, -1);
+    std::vector<int> forbidden;
+    nColors = 0;
+
+    for(int iel=0; iel<nElements; iel++)
+    {
+        for(int i=0; i<4; i++)
+        {
+            int nid = connectivity[4*iel+i];
+            for(int t=nodeptr[nid]; t<nodeptr[nid+1]; t++)
+            {
+                int c = color[nodeElements[t]];
+                if(c >= 0)
+                    forbidden[c] = iel;
+            }
+        }
+
+        int c = 0;
+        while(c<nColors && forbidden[c]==iel)
+            c++;
+
+        if(c == nColors)
+        {
+            nColors++;
+            forbidden.push_back(-1);
+        }
+        color[iel] = c;
+    }
+
+    // group the elements by colour
+    colorptr.assign(nColors+1, 0);
+    for(int iel=0; iel<nElements; iel++)
+        colorptr[color[iel]+1]++;
+    for(int c=0; c<nColors; c++)
+        colorptr[c+1] += colorptr[c];
+
+    colorElements.resize(nElements);
+    fill.assign(colorptr.begin(), colorptr.end()-1);
+    for(int iel=0; iel<nElements; iel++)
+        colorElements[fill[color[iel]]++] = iel;
+}
+
+
+bool Solid3D::adoptStiffnessPattern(Solid3D *mesh)
+{
+    // reuse the symbolic phase of a previous mesh with the same connectivity
+    if(mesh==nullptr || mesh->scatter.empty())
+        return false;
+    if(mesh->nNodes != nNodes || mesh->nElements != nElements)
+        return false;
+
+    for(int iel=0; iel<nElements; iel++)
+        for(int i=0; i<4; i++)
+            if(mesh->connectivity[4*iel+i] != storage.connectivity[4*iel+i])
+                return false;
+
+    // the reduced pattern also depends on the restricted dofs: the
+    // numbering is only taken when it gives the same equations
+    DofMap trial;
+    trial.nodeOrder = mesh->dofs.nodeOrder;
+    trial.setNodes(nodes, nNodes);
+    if(trial.equation != mesh->dofs.equation)
+        return false;
+
+    dofs = trial;
+    connectivity.swap(mesh->connectivity);
+    scatter.swap(mesh->scatter);
+    nColors = mesh->nColors;
+    colorptr.swap(mesh->colorptr);
+    colorElements.swap(mesh->colorElements);
+    k.n = mesh->k.n;
+    k.nnz = mesh->k.nnz;
+    k.rowptr.swap(mesh->k.rowptr);
+    k.colind.swap(mesh->k.colind);
+    k.values.swap(mesh->k.values);
+
+    mesh->scatter.clear();
+
+    return true;
+}
+
+
+void Solid3D::planSolver(void)
+{
+    if(int(dofs.nodeOrder.size()) != nNodes)
+    {
+        evalConnectivity();
+        dofs.renumber(nNodes, connectivity.data(), nElements, 4);
+    }
+    dofs.setNodes(nodes, nNodes);
+    if(connectivity.empty())
+        evalConnectivity();
+
+    // the pattern is only built if some assembled solver can fit in memory
+    SolverPlanner planner;
+    planner.evalMatrixSize(nNodes, connectivity.data(), nElements, 4, dofs.nFree);
+    if(planner.isAssemblyAffordable())
+    {
+        if(scatter.empty())
+            evalStiffnessPattern();
+
+        std::vector<int> blockptr;
+        dofs.nodeBlocks(blockptr);
+        planner.evalFactorSize(k, blockptr);
+    }
+    planner.choose();
+
+    isIterativeSolver = planner.method != SolverPlanner::sparseDirect;
+    isMatrixFree = planner.method == SolverPlanner::matrixFree;
+    solver.direct = planner.direct;
+    solver.preconditioning = planner.preconditioning;
+}
+
+
+void Solid3D::evalStiffnessMatrix(void)
+{
+    for(int i=0; i<nma; i++)
+        materials[i]->updateMatrixD();
+    stressMatrices.clear();
+
+    // bandwidth reducing numbering, once per loaded mesh
+    if(int(dofs.nodeOrder.size()) != nNodes)
+    {
+        evalConnectivity();
+        dofs.renumber(nNodes, connectivity.data(), nElements, 4);
+    }
+    dofs.setNodes(nodes, nNodes);
+    if(connectivity.empty())
+        evalConnectivity();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if(isMatrixFree)
+    {
+        // only the element data used by Solid3DOperator
+        k = SparseMatrix();
+        std::vector<int>().swap(scatter);
+
+        if(colorptr.empty())
+            evalElementColors();
+
+#pragma omp parallel for schedule(static)
+        for(int iel=0; iel<nElements; iel++)
+            elements[iel]->evalShapeDerivatives();
+
+        MsgLog::information(QString("Matrix-free stiffness operator: %1 free dof (%2 restricted), element data evaluated in %3 s")
+                            .arg(dofs.nFree).arg(dofs.nDofs-dofs.nFree).arg(timer.elapsed()/1000.));
+        return;
+    }
+
+    // pattern and colouring only for the first assembly of a mesh
+    if(scatter.empty())
+        evalStiffnessPattern();
+    double patternTime = timer.elapsed()/1000.;
+
+    k.zero();
+
+    // global stiffness matrix
+    double *values = k.values.data();
+    int nThreads = 1;
+
+    // elements of the same colour do not share rows of k
+#pragma omp parallel
+    {
+        TetraBatch batch;
+
+#ifdef _OPENMP
+#pragma omp single
+        nThreads = omp_get_num_threads();
+#endif
+
+        // each colour is processed in packs of TetraBatch::width elements
+        for(int c=0; c<nColors; c++)
+        {
+#pragma omp for schedule(static)
+            for(int t=colorptr[c]; t<colorptr[c+1]; t+=TetraBatch::width)
+            {
+                batch.gather(elements, &colorElements[t], std::min(int(TetraBatch::width), colorptr[c+1]-t),
+                             storage.coordinates.data(), storage.connectivity.data());
+                batch.evalStiffnessMatrices();
+                batch.scatter(values, scatter.data());
+            }
+        }
+    }
+
+    // model, threads and times: compare runs with OMP_NUM_THREADS=1
+    MsgLog::information(QString("Stiffness matrix assembled in %1 s (pattern %2 s): %3 elements, %4 colours, %5 threads, %6 elements per pack")
+                        .arg(timer.elapsed()/1000.-patternTime).arg(patternTime).arg(nElements).arg(nColors).arg(nThreads).arg(int(TetraBatch::width)));
 }
 
 
@@ -293,7 +533,10 @@ void Solid3D::evalLoadVector(double factor)
         f(3*nodes[i]->index+1) = factor * nodes[i]->loading[1];
         f(3*nodes[i]->index+2) = factor * nodes[i]->loading[2];
 
-        nodes[i]->loading = new double[3];
+        // the loading of the nodes shows the pressure forces from now on
+        nodes[i]->loading[0] = 0.0;
+        nodes[i]->loading[1] = 0.0;
+        nodes[i]->loading[2] = 0.0;
     }
 
     //#pragma omp parallel for num_threads(FEM_NUM_THREADS)
@@ -319,71 +562,91 @@ void Solid3D::evalLoadVector(double factor)
 }
 
 
-void Solid3D::solve(void)
+void Solid3D::liftPrescribedValues(std::vector<double> &fr)
 {
-    //std::ofstream flog("/home/ivan/Projects/data3/log_solver.txt");
+    if(!dofs.hasPrescribedValues())
+        return;
 
-    Mth::Matrix kc(k); // cópias
-    Mth::Vector fc(f);
+    // fr -= k(free, restricted)*prescribed, element by element
+    double ke[ElementTraits<Solid3DElement>::nKe];
 
-    // Aplica as condicoes de contorno
-    for(int i=0; i<nNodes; i++)
-        for(int j=0; j<3; j++)
-            if(nodes[i]->restrictions[j]==true)
+    for(int iel=0; iel<nElements; iel++)
+    {
+        int dof[12];
+        bool isLifted = false;
+        for(int i=0; i<4; i++)
+            for(int ii=0; ii<3; ii++)
             {
-                //flog<<"\n"<<i<<" "<<nodes[i]->restrictions[j];
-                int n = 3*nodes[i]->index+j;
-                for(int t=0; t<3*nNodes; t++)
-                {
-                    kc(n, t) = kc(t, n) =  0.0;
-                }
-                kc(n, n) = 1.0;
-                fc(n) = nodes[i]->displacements[j];
+                dof[3*i+ii] = 3*elements[iel]->nodes[i]->index+ii;
+                if(dofs.equation[dof[3*i+ii]]<0 && dofs.prescribed[dof[3*i+ii]]!=0.0)
+                    isLifted = true;
             }
 
+        if(!isLifted)
+            continue;
 
-    //    flog<<"\n\n Matriz de rigidez\n";
-    //    Mth::Matrix print(kc);
-    //    print *= 1e-8;
-    //    //kc *= 1e-8;
-    //    flog<<print;
-    //    //kc *= 1e+8;
+        elements[iel]->getStiffnessMatrix(ke);
 
-    //flog<<"\n\n Vetor de carga\n";
-    //flog<<f;
+        for(int r=0; r<12; r++)
+        {
+            int row = dofs.equation[dof[r]];
+            if(row < 0)
+                continue;
 
-    //    Mth::Matrix kcc(kc);
-    //    Mth::Vector fcc(fc);
+            for(int c=0; c<12; c++)
+                if(dofs.equation[dof[c]] < 0)
+                    fr[row] -= ke[12*r+c]*dofs.prescribed[dof[c]];
+        }
+    }
+}
 
-    //    std::cerr<<"\n\n Teste\n";
-    //    kcc.inverse();
-    //    std::cerr<<kcc*fcc;
 
-    // Aloca vetor para resultados
-    u.resize(3*nNodes);
+void Solid3D::solveConstrainedSystem(const std::vector<double> &fc, std::vector<double> &x)
+{
+    // reduced system of the free dofs: k is assembled without the
+    // restricted dofs, whose displacements are lifted to the right side
+    std::vector<double> fr(dofs.nFree), xr;
+    dofs.restrict(fc.data(), fr.data());
+    liftPrescribedValues(fr);
 
-//    QElapsedTimer timer;
-//    timer.start();
-//    std::cerr<<"starting linear system solver...\n";
+    if(solver.preconditioning == LinearSolver::smoothedAggregation)
+        dofs.rigidBodyModes(nodes, nNodes, solver.nearNullspace);
 
-    if(isIterativeSolver)
+    if(isMatrixFree)
     {
-        MsgLog::information(QString("Iterative solver, spare matrix on GPU"));
-        QString log;
-        kc.solve_sparse(fc, u, log); // solve sparse on GPU
-        //kc.solve_sparse_cpu(fc, u, log); // solve sparse on GPU
-        QStringList list;
-        list = log.split("\n");
-        for(int i=0; i<list.size();i++)
-        MsgLog::information(list[i]);
+        Solid3DOperator kc(this);
+
+        if(!isIterativeSolver)
+            MsgLog::information(QString("Matrix-free operator requires the iterative solver"));
+        MsgLog::information(QString("Iterative solver, matrix-free operator on CPU (%1 MB)").arg(kc.memory()));
+
+        solver.solveIterative(kc, dofs, fr, xr);
     }
     else
-    {
-        MsgLog::information(QString("Direct solver, dense matrix on CPU"));
-        QString log;
-        kc.solve_symmetric(fc, u, log); // solve dense on CPU
-MsgLog::information(log);
-    }
+        solver.solve(k, dofs, fr, xr, isIterativeSolver);
+
+    x.resize(dofs.nDofs);
+    dofs.expand(xr.data(), x.data());
+}
+
+
+void Solid3D::solve(void)
+{
+    //std::ofstream flog("/home/ivan/Projects/data3/log_solver.txt");
+
+    std::vector<double> fc(3*nNodes);
+    for(int i=0; i<3*nNodes; i++)
+        fc[i] = f(i);
+
+    // Aloca vetor para resultados
+    u.resize(3*nNodes);
+
+    // Resolve o sistema reduzido (condicoes de contorno)
+    std::vector<double> x;
+    solveConstrainedSystem(fc, x);
+
+    for(int i=0; i<3*nNodes; i++)
+        u(i) = x[i];
 
     //std::cerr<<"timing: "<<timer.elapsed()/1000.;
 
@@ -413,362 +676,259 @@ MsgLog::information(log);
     //    flog<<reactions;
 
 
-    Mth::Vector ue(12);
-    Mth::Vector se(12);
+    evalResults();
+}
 
-    Mth::Matrix S(nElements, 7); //n1, n2, n3, n12, n23, n31, von mises
 
-    //#pragma omp parallel for num_threads(FEM_NUM_THREADS)
+void Solid3D::evalStressMatrices(void)
+{
+    stressMatrices.resize(72*size_t(nElements));
 
-    for(int i=0; i<nElements; i++)
+    // DB = D*B, the same expansion as the stiffness matrices
+#pragma omp parallel for schedule(static)
+    for(int iel=0; iel<nElements; iel++)
     {
-        for(int j=0; j<4; j++)
-        {
-            ue(3*j+0) = u(3*elements[i]->nodes[j]->index+0);
-            ue(3*j+1) = u(3*elements[i]->nodes[j]->index+1);
-            ue(3*j+2) = u(3*elements[i]->nodes[j]->index+2);
-        }
+        Solid3DElement *element = elements[iel];
+        double *DB = &stressMatrices[72*size_t(iel)];
 
-        elements[i]->getStress(ue,se);
-
-        for(int j=0; j<6; j++)
-            S(i,j) = se(j);
+        double D[6][6];
+        for(int s=0; s<6; s++)
+            for(int j=0; j<6; j++)
+                D[s][j] = element->material->D(s,j);
 
-        // Von Mises stress
-        S(i,6) = sqrt(0.5*((se(0)-se(1))*(se(0)-se(1)) + (se(1)-se(2))*(se(1)-se(2)) +
-                           (se(2)-se(0))*(se(2)-se(0)) +
-                           6.0*(se(3)*se(3) + se(4)*se(4) + se(5)*se(5))));
+        for(int s=0; s<6; s++)
+            for(int i=0; i<4; i++)
+                Solid3DElement::evalDB(D[s], element->b[i], element->c[i], element->d[i], &DB[12*s+3*i]);
     }
+}
 
-    //    flog<<"\n\n Tensoes normais (elementos)\n";
-    //    flog<<S;
 
-#define NRV 14
-    Snodes.resize(nNodes, NRV); //n1, n2, n3, n12, n23, n31, von mises, ux, uy, uz, u
-    Mth::Vector contribution(nNodes);
+void Solid3D::evalNodeElements(void)
+{
+    // node -> elements adjacency (CSR), elements in increasing order
+    const int *connectivity = storage.connectivity.data();
+    nodeElementPtr.assign(nNodes+1, 0);
+    for(int t=0; t<4*nElements; t++)
+        nodeElementPtr[connectivity[t]+1]++;
 
-    Snodes = 0.0;
-    contribution = 0.0;
+    for(int i=0; i<nNodes; i++)
+        nodeElementPtr[i+1] += nodeElementPtr[i];
 
-    //#pragma omp parallel for num_threads(FEM_NUM_THREADS)
-    for(int i=0; i<nElements; i++)
-    {
-        for(int j=0; j<4; j++)
-        {
-            int nid = elements[i]->nodes[j]->index;
-            contribution(nid) += 1.0;
-            for(int t=0; t<7; t++)
-                Snodes(nid,t) += S(i,t);
-        }
-    }
+    nodeElements.resize(4*size_t(nElements));
+    std::vector<int> position(nodeElementPtr.begin(), nodeElementPtr.end()-1);
+    for(int t=0; t<4*nElements; t++)
+        nodeElements[position[connectivity[t]]++] = t/4;
+}
 
-    for(int i=0; i<nNodes; i++)
-        for(int t=0; t<7; t++)
-            Snodes(i,t) /= contribution(i);
 
-    for(int i=0; i<nNodes; i++)
-    {
-        Snodes(i,7) = u(3*i); // ux
-        Snodes(i,8) = u(3*i+1); // uy
-        Snodes(i,9) = u(3*i+2); // uz
-        Snodes(i,10) = sqrt(u(3*i)*u(3*i)+u(3*i+1)*u(3*i+1)+u(3*i+2)*u(3*i+2));
-    }
+void Solid3D::evalResults(void)
+{
+    // the channels of Snodes are evaluated on request (evalResult)
+    Snodes.resize(nNodes, NRV); //n1, n2, n3, n12, n23, n31, von mises, ux, uy, uz, u, sigma1, sigma2, sigma3
+    Smax.resize(NRV);
+    Smin.resize(NRV);
+    isResultReady.assign(NRV, false);
+
+    isSolved = true;
+}
 
 
-    // calculate principal stress
+void Solid3D::evalResult(int t)
+{
+    if(t<0 || t>=int(isResultReady.size()) || isResultReady[t])
+        return;
 
-    double w[3];
-    double **m = new double*[3];
-    double **v = new double*[3];
-    for(int i=0; i<3;i++)
-    {
-        m[i] = new double[3];
-        v[i] = new double[3];
-    }
+    if(t < 7)
+        evalNodalStresses();
+    else if(t < 11)
+        evalNodalDisplacements();
+    else
+        evalPrincipalResults();
+}
 
 
+void Solid3D::evalResultLimits(int t)
+{
+    Smax(t) = Snodes(0,t);
+    Smin(t) = Snodes(0,t);
     for(int i=0; i<nNodes; i++)
     {
-        m[0][0] = Snodes(i,0); //n1
-        m[1][0] = Snodes(i,3); //n12
-        m[2][0] = Snodes(i,5); //n31
-        m[0][1] = Snodes(i,3); //n12
-        m[1][1] = Snodes(i,1); //n2
-        m[2][1] = Snodes(i,4); //n23
-        m[0][2] = Snodes(i,5); //n31
-        m[1][2] = Snodes(i,4); //n23
-        m[2][2] = Snodes(i,2); //n3
-
-        vtkMath::Jacobi(m, w, v);
-
-        Snodes(i,11) = w[0]; // sigma1
-        Snodes(i,12) = w[1]; // sigma2
-        Snodes(i,13) = w[2]; // sigma3
+        if(Snodes(i,t)>Smax(t)) Smax(t) = Snodes(i,t);
+        if(Snodes(i,t)<Smin(t)) Smin(t) = Snodes(i,t);
     }
+    MsgLog::result(QString("%1 - min: %2, max: %3").arg(strResults[t]).arg(Smin(t)).arg(Smax(t)));
 
+    isResultReady[t] = true;
+}
 
 
-//    Selements.resize(nElements, 10); //n1, n2, n3, n12, n23, n31, von mises, ux, uy, uz
-
-//    //#pragma omp parallel for num_threads(FEM_NUM_THREADS)
-//    for(int i=0; i<nElements; i++)
-//        for(int t=0; t<7; t++)
-//            Selements(i,t) = S(i,t);
-
-    //    for(int i=0; i<nElements; i++)
-    //    {
-    //        Selements(i,7) = u(3*i); // ux
-    //        Snodes(i,8) = u(3*i+1); // uy
-    //        Snodes(i,9) = u(3*i+2); // uz
-    //    }
-
-
-
-    //    //    stress.clear();
-    //    flog<<"\n\n Tensoes normais (nodes)\n";
-    //    flog<<Snodes;
-
-
+void Solid3D::evalNodalStresses(void)
+{
+    if(stressMatrices.size() != 72*size_t(nElements))
+        evalStressMatrices();
+    if(int(nodeElementPtr.size()) != nNodes+1)
+        evalNodeElements();
 
-    Smax.resize(NRV);
-    Smin.resize(NRV);
+    //n1, n2, n3, n12, n23, n31, von mises of each element
+    std::vector<double> S(7*size_t(nElements));
+    const int *connectivity = storage.connectivity.data();
 
-    //#pragma omp parallel for num_threads(FEM_NUM_THREADS)
-    for(int t=0; t<NRV; t++)
+#pragma omp parallel for schedule(static)
+    for(int i=0; i<nElements; i++)
     {
-        Smax(t) = Snodes(0,t);
-        Smin(t) = Snodes(0,t);
-        for(int i=0; i<nNodes; i++)
+        double ue[12];
+        for(int j=0; j<4; j++)
         {
-            if(Snodes(i,t)>Smax(t)) Smax(t) = Snodes(i,t);
-            if(Snodes(i,t)<Smin(t)) Smin(t) = Snodes(i,t);
+            int nid = connectivity[4*i+j];
+            ue[3*j+0] = u(3*nid+0);
+            ue[3*j+1] = u(3*nid+1);
+            ue[3*j+2] = u(3*nid+2);
         }
-        MsgLog::result(QString("%1 - min: %2, max: %3").arg(strResults[t]).arg(Smin(t)).arg(Smax(t)));
-    }
 
-    //flog<<"\n\n Tensoes maximas\n";
-    //flog<<Smax;
+        const double *DB = &stressMatrices[72*size_t(i)];
+        double *se = &S[7*size_t(i)];
+        for(int s=0; s<6; s++)
+        {
+            double sum = 0.0;
+            for(int t=0; t<12; t++)
+                sum += DB[12*s+t]*ue[t];
+            se[s] = sum;
+        }
 
-    //flog<<"\n\n Tensoes minimas\n";
-    //flog<<Smin;
+        // Von Mises stress
+        se[6] = sqrt(0.5*((se[0]-se[1])*(se[0]-se[1]) + (se[1]-se[2])*(se[1]-se[2]) +
+                          (se[2]-se[0])*(se[2]-se[0]) +
+                          6.0*(se[3]*se[3] + se[4]*se[4] + se[5]*se[5])));
+    }
 
+    // nodal averages gathered over the elements of each node: every thread
+    // writes only its own nodes
+#pragma omp parallel for schedule(static)
+    for(int i=0; i<nNodes; i++)
+    {
+        double sum[7] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        for(int p=nodeElementPtr[i]; p<nodeElementPtr[i+1]; p++)
+            for(int t=0; t<7; t++)
+                sum[t] += S[7*size_t(nodeElements[p])+t];
 
-    //flog.close();
+        double contribution = nodeElementPtr[i+1]-nodeElementPtr[i];
+        for(int t=0; t<7; t++)
+            Snodes(i,t) = sum[t]/contribution;
+    }
 
-    isSolved = true;
+    for(int t=0; t<7; t++)
+        evalResultLimits(t);
 }
 
 
-void Solid3D::solve_simulation(int steps)
+void Solid3D::evalNodalDisplacements(void)
 {
-    nSteps = steps;
-
-    f_simulation.resize(3*nNodes, nSteps);
-    //f_simulation = 0.0;
-
-    double delta = 1.0/nSteps;
-    double factor;
-
-    for(int k=0; k<nSteps; k++)
-    {
-        factor = k*delta;
-        for(int i=0; i<3*nNodes; i++)
-            f_simulation(i, k) = factor * f(i);
-    }
-
-
-
-    Mth::Matrix kc(k); // cópias
-    Mth::Matrix fc(f_simulation);
-
-    // Aplica as condicoes de contorno
+#pragma omp parallel for schedule(static)
     for(int i=0; i<nNodes; i++)
-        for(int j=0; j<3; j++)
-            if(nodes[i]->restrictions[j]==true)
-            {
-                int n = 3*nodes[i]->index+j;
-                for(int t=0; t<3*nNodes; t++)
-                    kc(n, t) = kc(t, n) =  0.0;
-
-                kc(n, n) = 1.0;
-                for(int k=0; k<nSteps; k++)
-                    fc(n,k) = nodes[i]->displacements[j];
-            }
-    //    std::cerr<<"ckecking symmetry...";
-    //    for(int i=0; i<3*nNodes; i++)
-    //        for(int j=0; j<3*nNodes; j++)
-    //            if(fabs(kc(i,j)-kc(j,i))>1e-5)
-    //                std::cerr<<"\n"<<i<<" "<<j<<" - "<<fabs(kc(i,j)-kc(j,i));
-
-    u_simulation.resize(3*nNodes, nSteps);
-
-
-    QElapsedTimer timer;
-    timer.start();
-    std::cerr<<"start solving linear system...\n";
-    //kc.solve(fc, u_simulation);
-    //kc.solve_symmetric(fc, u_simulation);
-    //kc.solve_gpu(fc, u_simulation);
-    //*
-    /////////////////////////////
-    Mth::Matrix fcc(3*nNodes);
-    Mth::Matrix ucc(3*nNodes);
-    for(int i=0; i<3*nNodes; i++)
-    {
-        fcc(i) = f_simulation(i,nSteps-1);
-    }
-    kc.solve_sparse(fcc, ucc);
-
-    for(int k=0; k<nSteps; k++)
     {
-        factor = k*delta;
-        for(int i=0; i<3*nNodes; i++)
-            u_simulation(i,k) = ucc(i)*factor;
+        Snodes(i,7) = u(3*i); // ux
+        Snodes(i,8) = u(3*i+1); // uy
+        Snodes(i,9) = u(3*i+2); // uz
+        Snodes(i,10) = sqrt(u(3*i)*u(3*i)+u(3*i+1)*u(3*i+1)+u(3*i+2)*u(3*i+2));
     }
-    /////////////////////////////
-    //*/
-
-    std::cerr<<"timing 0: "<<timer.elapsed()/1000.;
 
-    //reactions_simulation.resize(3*nNodes, nSteps);
+    for(int t=7; t<11; t++)
+        evalResultLimits(t);
+}
 
-    //reactions_simulation = k*u_simulation;
 
+void Solid3D::evalPrincipalResults(void)
+{
+    evalResult(0);
 
-    //std::cerr<<"timing 1: "<<timer.elapsed()/1000.;
+    // stress components (n1, n2, n3, n12, n23, n31) and principal values
+    // by component, for evalPrincipalStresses
+    std::vector<double> nodal(9*size_t(nNodes));
+    double *components[9];
+    for(int t=0; t<9; t++)
+        components[t] = &nodal[t*size_t(nNodes)];
 
-    Mth::Vector ue(12);
-    Mth::Vector se(12);
+    for(int i=0; i<nNodes; i++)
+        for(int t=0; t<6; t++)
+            components[t][i] = Snodes(i,t);
 
-    Mth::Matrix *S = new Mth::Matrix[nSteps];
+    evalPrincipalStresses(nNodes, components[0], components[1], components[2],
+                          components[3], components[4], components[5],
+                          components[6], components[7], components[8]);
 
-    for(int k=0; k<nSteps; k++)
+    for(int i=0; i<nNodes; i++)
     {
-
-        S[k].resize(nElements, 7); //n1, n2, n3, n12, n23, n31, von mises
-
+        Snodes(i,11) = components[6][i]; // sigma1
+        Snodes(i,12) = components[7][i]; // sigma2
+        Snodes(i,13) = components[8][i]; // sigma3
     }
 
-    //std::cerr<<"timing 2: "<<timer.elapsed()/1000.;
-
-    //#pragma omp parallel for schedule(static) num_threads(8)
-    for(int i=0; i<nElements; i++)
-        for(int k=0; k<nSteps; k++)
-        {
-            for(int j=0; j<4; j++)
-            {
-                ue(3*j+0) = u_simulation(3*elements[i]->nodes[j]->index+0,k);
-                ue(3*j+1) = u_simulation(3*elements[i]->nodes[j]->index+1,k);
-                ue(3*j+2) = u_simulation(3*elements[i]->nodes[j]->index+2,k);
-            }
-
-            elements[i]->getStress(ue,se);
-
-            for(int j=0; j<6; j++)
-                S[k](i,j) = se(j);
+    for(int t=11; t<NRV; t++)
+        evalResultLimits(t);
+}
 
-            // Von Mises stress
-            S[k](i,6) = sqrt(0.5*((se(0)-se(1))*(se(0)-se(1)) + (se(1)-se(2))*(se(1)-se(2)) +
-                                  (se(2)-se(0))*(se(2)-se(0)) +
-                                  6.0*(se(3)*se(3) + se(4)*se(4) + se(5)*se(5))));
-        }
 
-    //std::cerr<<"timing 3: "<<timer.elapsed()/1000.;
+void Solid3D::solve_simulation(int steps)
+{
+    nSteps = steps;
 
-    Snodes_simulation = new Mth::Matrix[nSteps];
-    Mth::Vector contribution(nNodes);
+    std::vector<double> fc(3*nNodes);
+    for(int i=0; i<3*nNodes; i++)
+        fc[i] = f(i);
 
-    for(int k=0; k<nSteps; k++)
-    {
-        Snodes_simulation[k].resize(nNodes, 10); //n1, n2, n3, n12, n23, n31, von mises, ux, uy, uz
+    QElapsedTimer timer;
+    timer.start();
+    std::cerr<<"start solving linear system...\n";
 
-        Snodes_simulation[k] = 0.0;
-        contribution = 0.0;
+    // Resolve o sistema reduzido (condicoes de contorno)
+    std::vector<double> x;
+    solveConstrainedSystem(fc, x);
 
-        //#pragma omp parallel for num_threads(FEM_NUM_THREADS)
-        for(int i=0; i<nElements; i++)
-        {
-            for(int j=0; j<4; j++)
-            {
-                int nid = elements[i]->nodes[j]->index;
-                contribution(nid) += 1.0;
-                for(int t=0; t<7; t++)
-                    Snodes_simulation[k](nid,t) += S[k](i,t);
-            }
-        }
+    std::cerr<<"timing 0: "<<timer.elapsed()/1000.;
 
-        for(int i=0; i<nNodes; i++)
-            for(int t=0; t<7; t++)
-                Snodes_simulation[k](i,t) /= contribution(i);
+    // the problem is linear: every step is its load factor times the
+    // results of the full load, which are the only ones stored
+    u.resize(3*nNodes);
+    for(int i=0; i<3*nNodes; i++)
+        u(i) = x[i];
 
+    evalResults();
+    std::vector<double> nodal(size_t(nNodes)*NRV);
+    for(int t=0; t<NRV; t++)
+    {
+        evalResult(t);
         for(int i=0; i<nNodes; i++)
-        {
-            Snodes_simulation[k](i,7) = u_simulation(3*i, k); // ux
-            Snodes_simulation[k](i,8) = u_simulation(3*i+1, k); // uy
-            Snodes_simulation[k](i,9) = u_simulation(3*i+2, k); // uz
-        }
-
+            nodal[size_t(i)*NRV+t] = Snodes(i,t);
     }
 
-    Smax.resize(10);
-    Smin.resize(10);
+    f_simulation.setSteps(nSteps);
+    f_simulation.setField(fc);
+    u_simulation.setSteps(nSteps);
+    u_simulation.setField(x);
+    Snodes_simulation.setSteps(nSteps);
+    Snodes_simulation.setField(nodal, NRV);
 
-    //#pragma omp parallel for num_threads(FEM_NUM_THREADS)
-    for(int t=0; t<10; t++)
+    for(int t=0; t<NRV; t++)
     {
-        Smax(t) = Snodes_simulation[0](0,t);
-        Smin(t) = Snodes_simulation[0](0,t);
-        for(int k=0; k<nSteps; k++)
-            for(int i=0; i<nNodes; i++)
-            {
-                if(Snodes_simulation[k](i,t)>Smax(t)) Smax(t) = Snodes_simulation[k](i,t);
-                if(Snodes_simulation[k](i,t)<Smin(t)) Smin(t) = Snodes_simulation[k](i,t);
-            }
+        double min, max;
+        Snodes_simulation.limits(t, min, max);
+        Smin(t) = min;
+        Smax(t) = max;
     }
 
     isSolved_simulation = true;
 
-
-    u.resize(3*nNodes);
-    reactions.resize(3*nNodes);
-    Snodes.resize(nElements,10);
-
+    // the model shows the last step
     for(int i=0; i<3*nNodes; i++)
-    {
-        u(i) = u_simulation(i,nSteps-1);
-        reactions(i) = reactions_simulation(i,nSteps-1);
-    }
-
+        u(i) = u_simulation(i, nSteps-1);
 
-    for(int t=0; t<10; t++)
-        for(int i=0; i<nElements; i++)
-        {
-            Snodes(i,t) = Snodes_simulation[nSteps-1](i, t);
-        }
+    for(int i=0; i<nNodes; i++)
+        for(int t=0; t<NRV; t++)
+            Snodes(i,t) = Snodes_simulation(i, t, nSteps-1);
 
     //std::cerr<<"timing 4: "<<timer.elapsed()/1000.;
 
     isSolved = true;
-
-}
-
-
-void Solid3D::evalStressLimits(void)
-{
-    Smax.resize(7);
-    Smin.resize(7);
-
-    //#pragma omp parallel for num_threads(FEM_NUM_THREADS)
-    for(int t=0; t<7; t++)
-    {
-        Smax(t) = Snodes(0,t);
-        Smin(t) = Snodes(0,t);
-        for(int i=0; i<nNodes; i++)
-        {
-            if(Snodes(i,t)>Smax(t)) Smax(t) = Snodes(i,t);
-            if(Snodes(i,t)<Smin(t)) Smin(t) = Snodes(i,t);
-        }
-    }
 }
 
 
@@ -790,16 +950,10 @@ void Solid3D::evalStressLimits(void)
 
 Solid3D::~Solid3D()
 {
-    if(isMounted)
-    {
-        for(int i=0; i<nElements; i++)
-            delete elements[i];
-        delete [] elements;
-
-        for(int i=0; i<nNodes; i++)
-            delete nodes[i];
-        delete [] nodes;
-    }
+    // the nodes and elements themselves belong to storage, the pointer
+    // arrays are freed also when the mesh was not mounted
+    delete [] elements;
+    delete [] nodes;
 }
 
 
@@ -826,6 +980,8 @@ void Solid3D::report(QString filename, bool isNodesInfo)
         flog<<","<<"Principal stress 3";
         flog<<std::endl;
 
+        for(int t=0; t<NRV; t++)
+            evalResult(t);
 
         for(int i=0; i<nNodes; i++)
         {
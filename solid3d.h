@@ -20,6 +20,12 @@
 #include "node3d.h"
 #include "solid3delement.h"
 #include "msglog.h"
+#include "sparsematrix.h"
+#include "solid3doperator.h"
+#include "dofmap.h"
+#include "linearsolver.h"
+#include "rampresult.h"
+#include "solidmesh.h"
 
 #include <mth/matrix.h>
 #include <mth/vector.h>
@@ -32,14 +38,50 @@ class Solid3DReader;
 class Solid3D
 {
     friend class Solid3DReader;
+    friend class Solid3DOperator;
 
 private:
     int ndi, nlo, nre, nma;
 
-    Mth::Matrix k;
+    DofMap dofs;
+    SparseMatrix k; // free dofs only
     Mth::Vector f;
 
+    // symbolic assembly data: element connectivity and, for each element,
+    // the 12x12 positions of ke in k.values (row by row)
+    std::vector<int> connectivity;
+    std::vector<int> scatter;
+
+    // elements grouped by colour: no two elements of a colour share a node
+    int nColors;
+    std::vector<int> colorptr;
+    std::vector<int> colorElements;
+
+    // stress recovery: D*B of each element (6x12, row by row) and the
+    // elements of each node, for the nodal averages
+    std::vector<double> stressMatrices;
+    std::vector<int> nodeElementPtr;
+    std::vector<int> nodeElements;
+
+    void evalConnectivity(void);
+    void evalElementColors(void);
+    void evalStressMatrices(void);
+    void evalNodeElements(void);
+
+    void liftPrescribedValues(std::vector<double> &fr);
+    void solveConstrainedSystem(const std::vector<double> &fc, std::vector<double> &x);
+    void evalResults(void); // nodal results of a new u, evaluated on request
+
+    // channels of Snodes already evaluated for the current u
+    std::vector<bool> isResultReady;
+
+    void evalResultLimits(int t);
+    void evalNodalStresses(void);
+    void evalNodalDisplacements(void);
+    void evalPrincipalResults(void);
+
 public:
+    SolidMesh storage; // nodes and elements below point into it
     Node3D **nodes;
     Solid3DElement **elements;
     Material **materials;
@@ -60,7 +102,6 @@ public:
     Mth::Vector reactions;
     Mth::Matrix Snodes;
     Mth::Matrix Selements;
-    Mth::Matrix *Snodes_simulation;
 
 
     Mth::Vector Smax;
@@ -72,27 +113,31 @@ public:
 
     void report(QString filename, bool isNodesInfo=true);
 
+    void evalStiffnessPattern(void);
+    bool adoptStiffnessPattern(Solid3D *mesh);
+    void planSolver(void); // sets the solver from the size of the model
     void evalStiffnessMatrix(void);
     void evalLoadVector(double factor=1.0);
 
-    void evalStressLimits(void);
+    void evalResult(int t); // channel t of Snodes, Smin and Smax (strResults), on the first request
 
     void infoGeometry(double &volume, double &weight);
 
     void solve(void);
 
-    // variables for ramp computation
+    // variables for ramp computation: steps evaluated on access
     int nSteps;
-    Mth::Matrix f_simulation;
-    Mth::Matrix u_simulation;
-
-    Mth::Matrix reactions_simulation;
-    Mth::Matrix *stress_simulation;
+    RampResult f_simulation;
+    RampResult u_simulation;
+    RampResult Snodes_simulation; // nNodes x 14, as Snodes
 
     void solve_simulation(int nSteps);
     //void stresslimits_simulation(double &min, double &max);
+
     bool isSolved_simulation;
     bool isIterativeSolver;
+    LinearSolver solver; // direct method, tolerance, iterations and preconditioner
+    bool isMatrixFree; // solve with Solid3DOperator, k is not assembled
 
 
 //protected:
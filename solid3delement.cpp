@@ -22,11 +22,13 @@
 Solid3DElement::Solid3DElement()
 {
     index = -1;
+    V = 0.0;
 
     nodes = nullptr;
     material = nullptr;
     areas = nullptr;
     normals = nullptr;
+    pressure = nullptr;
     pface = -1;
 
 }
@@ -67,16 +69,13 @@ Solid3DElement::Solid3DElement(int index, Solid3DElement *element)
 }
 
 
-void Solid3DElement::getStiffnessMatrix(Mth::Matrix &ke)
+void Solid3DElement::evalShapeDerivatives(void)
 {
-    B.resize(6,12);
-    B = 0.0;
-
     double x[4];
     double y[4];
     double z[4];
 
-    double /*a,*/b,c,d;
+    double /*a,*/bi,ci,di;
     int id[4];
 
     for(int i=0; i<4; i++)
@@ -94,14 +93,14 @@ void Solid3DElement::getStiffnessMatrix(Mth::Matrix &ke)
         }
 
 
-        b = -(y[2]*z[3]+y[1]*z[2]+y[3]*z[1])+(y[2]*z[1]+y[1]*z[3]+y[3]*z[2]);
-        c = -(x[1]*z[3]+x[2]*z[1]+x[3]*z[2])+(x[3]*z[1]+x[2]*z[3]+x[1]*z[2]);
-        d = -(x[1]*y[2]+x[2]*y[3]+x[3]*y[1])+(x[3]*y[2]+x[2]*y[1]+x[1]*y[3]);
+        bi = -(y[2]*z[3]+y[1]*z[2]+y[3]*z[1])+(y[2]*z[1]+y[1]*z[3]+y[3]*z[2]);
+        ci = -(x[1]*z[3]+x[2]*z[1]+x[3]*z[2])+(x[3]*z[1]+x[2]*z[3]+x[1]*z[2]);
+        di = -(x[1]*y[2]+x[2]*y[3]+x[3]*y[1])+(x[3]*y[2]+x[2]*y[1]+x[1]*y[3]);
 
         // erro no livro do zienkiewicz and taylor??????
-        b *= ((i+2)%2)? -1:1;
-        c *= ((i+1)%2)?  1:-1;
-        d *= ((i+2)%2)? -1:1;
+        bi *= ((i+2)%2)? -1:1;
+        ci *= ((i+1)%2)?  1:-1;
+        di *= ((i+2)%2)? -1:1;
 
         if(i==0)
         {
@@ -113,53 +112,99 @@ void Solid3DElement::getStiffnessMatrix(Mth::Matrix &ke)
 
         }
 
-        B(0,3*i+0) = b;
-        B(1,3*i+1) = c;
-        B(2,3*i+2) = d;
-
-        B(3,3*i+0) = c;
-        B(3,3*i+1) = b;
-
-        B(4,3*i+1) = d;
-        B(4,3*i+2) = c;
-
-        B(5,3*i+0) = d;
-        B(5,3*i+2) = b;
+        b[i] = bi;
+        c[i] = ci;
+        d[i] = di;
+    }
 
+    double factor = 1.0/(6.0*V);
+    for(int i=0; i<4; i++)
+    {
+        b[i] *= factor;
+        c[i] *= factor;
+        d[i] *= factor;
     }
+}
 
-    B *= 1.0/(6.0*V);
 
-    Mth::Matrix temp(6,12);
-    Mth::Matrix Bt(12,6);
+void Solid3DElement::getStiffnessMatrix(double *ke)
+{
+    // ke = V*Bt*D*B with fixed-size arrays on the stack; each column of B
+    // has only 3 nonzeros (b, c, d), so the products skip the zeros
+    typedef ElementTraits<Solid3DElement> T;
+
+    evalShapeDerivatives();
+
+    double D[T::nStress][T::nStress];
+    for(int i=0; i<T::nStress; i++)
+        for(int j=0; j<T::nStress; j++)
+            D[i][j] = material->D(i,j);
+
+    // DB = D*B (6x12)
+    double DB[T::nStress][T::nDofs];
+    for(int i=0; i<T::nNodes; i++)
+        for(int s=0; s<T::nStress; s++)
+            evalDB(D[s], b[i], c[i], d[i], &DB[s][3*i]);
+
+    // upper blocks of Bt*DB, lower blocks by symmetry
+    for(int i=0; i<T::nNodes; i++)
+        for(int j=3*i; j<T::nDofs; j++)
+        {
+            ke[(3*i+0)*T::nDofs+j] = V*(b[i]*DB[0][j] + c[i]*DB[3][j] + d[i]*DB[5][j]);
+            ke[(3*i+1)*T::nDofs+j] = V*(c[i]*DB[1][j] + b[i]*DB[3][j] + d[i]*DB[4][j]);
+            ke[(3*i+2)*T::nDofs+j] = V*(d[i]*DB[2][j] + c[i]*DB[4][j] + b[i]*DB[5][j]);
+        }
 
-    for(int i=0; i<12; i++)
-        for(int j=0; j<6; j++)
-            Bt(i,j) = B(j,i);
+    for(int i=0; i<T::nDofs; i++)
+        for(int j=0; j<3*(i/3); j++)
+            ke[i*T::nDofs+j] = ke[j*T::nDofs+i];
+}
 
-    temp = material->D*B;
-    //ke = B.ATxB(temp);
-    ke = Bt*temp;
 
-    ke *= V;
+void Solid3DElement::getStress(const double *ue, double *se) const
+{
+    // strains = B*ue
+    double e[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    for(int i=0; i<4; i++)
+    {
+        e[0] += b[i]*ue[3*i];
+        e[1] += c[i]*ue[3*i+1];
+        e[2] += d[i]*ue[3*i+2];
+        e[3] += c[i]*ue[3*i] + b[i]*ue[3*i+1];
+        e[4] += d[i]*ue[3*i+1] + c[i]*ue[3*i+2];
+        e[5] += d[i]*ue[3*i] + b[i]*ue[3*i+2];
+    }
 
+    for(int i=0; i<6; i++)
+    {
+        se[i] = 0.0;
+        for(int j=0; j<6; j++)
+            se[i] += material->D(i,j)*e[j];
+    }
 }
 
 
 void Solid3DElement::getStress(Mth::Vector &ue, Mth::Vector &se)
 {
-    se = material->D*B*ue;
+    double uev[12], sev[6];
+    for(int i=0; i<12; i++)
+        uev[i] = ue(i);
+
+    getStress(uev, sev);
+
+    for(int i=0; i<6; i++)
+        se(i) = sev[i];
 }
 
 
 
 void Solid3DElement::evaluateNormals(void)
 {
-    if(areas) delete [] areas;
-    if(normals) delete [] normals;
-
-    normals = new QVector3D[4];
-    areas = new double[4];
+    // the arrays of the elements of a SolidMesh are kept
+    if(normals == nullptr)
+        normals = new QVector3D[4];
+    if(areas == nullptr)
+        areas = new double[4];
 
 
     for(int i=0; i<4; i++)
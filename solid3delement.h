@@ -19,6 +19,7 @@
 
 #include "node3d.h"
 #include "material.h"
+#include "elementtraits.h"
 #include <mth/matrix.h>
 #include <QVector3D>
 
@@ -43,7 +44,7 @@ public:
     int index;
     Node3D **nodes;
     Material *material;
-    Mth::Matrix B;
+    double b[4], c[4], d[4]; // shape function derivatives (B matrix coefficients)
     double *pressure;
     double V;
     int pface;
@@ -54,10 +55,24 @@ public:
     Solid3DElement();
     Solid3DElement(int index, Solid3DElement *element);
     Solid3DElement(int index, Node3D *node0, Node3D *node1, Node3D *node2, Node3D *node3, Material *material);
+    void evalShapeDerivatives(void);
+    void getStress(const double *ue, double *se) const;
     void getStress(Mth::Vector &ue, Mth::Vector &se);
-    void getStiffnessMatrix(Mth::Matrix &ke);
+    void getStiffnessMatrix(double *ke);
     void evaluateNormals(void);
 
+    // columns 3*i..3*i+2 of row s of D*B from the row Ds of D and the
+    // coefficients of node i; B has only b, c, d in those columns. Shared
+    // by the stiffness matrices (scalar and TetraBatch) and the stresses;
+    // stride is the distance between consecutive entries (lanes of a pack)
+    template<int stride = 1>
+    static inline void evalDB(const double *Ds, double b, double c, double d, double *DBs)
+    {
+        DBs[0*stride] = Ds[0*stride]*b + Ds[3*stride]*c + Ds[5*stride]*d;
+        DBs[1*stride] = Ds[1*stride]*c + Ds[3*stride]*b + Ds[4*stride]*d;
+        DBs[2*stride] = Ds[2*stride]*d + Ds[4*stride]*c + Ds[5*stride]*b;
+    }
+
 
 //protected:
     virtual ~Solid3DElement();
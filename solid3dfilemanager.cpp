@@ -19,12 +19,12 @@
 #include <QtWidgets>
 #include <QFile>
 #include <QIODevice>
-#include <QTextStream>
 #include <QObject>
 
 #include <iostream>
 
 #include "msglog.h"
+#include "cdbtokenizer.h"
 
 #define FSXL_ext "fsxl"
 #define CDB_ext "cdb"
@@ -48,6 +48,7 @@ Solid3DFileManager::Solid3DFileManager(QTreeWidget *treeWidget)
     elementIcon.addPixmap(QPixmap(":/icons/element.png"));
 
     currentfilename = "";
+    isTreeBuilt = false;
 
 }
 
@@ -70,11 +71,23 @@ bool Solid3DFileManager::openFile(void)
 
     if(type == CDB_ext)
     {
-        this->readCdbFile(currentfilename);
+        // Solid3DReader loads the model from the CDB file in one pass; the
+        // tree is built when it is expanded or saved
+        cdbfilename = currentfilename;
         currentfilename.replace(CDB_ext, FSXL_ext);
+        isTreeBuilt = false;
+
+        QTreeWidgetItem *mesh = createChildItem(0);
+        mesh->setIcon(0, meshIcon);
+        mesh->setText(0, QObject::tr("Solid3D"));
+        mesh->setText(1, QObject::tr("expand to load the tree"));
+        mesh->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
     }
     else if(type == FSXL_ext)
-        this->readFsxlFile(currentfilename);
+    {
+        cdbfilename = "";
+        isTreeBuilt = this->readFsxlFile(currentfilename);
+    }
 
     treeWidget->setColumnCount(2);
     treeWidget->resizeColumnToContents(1);
@@ -86,7 +99,7 @@ bool Solid3DFileManager::openFile(void)
 
 bool Solid3DFileManager::saveFile(void)
 {
-    if (currentfilename.isEmpty())
+    if (currentfilename.isEmpty() || !buildTree())
         return false;
 
     MsgLog::information(QString("Writing file ")+currentfilename);
@@ -108,6 +121,27 @@ bool Solid3DFileManager::saveFile(void)
 
 
 
+bool Solid3DFileManager::buildTree(void)
+{
+    if(isTreeBuilt)
+        return true;
+    if(cdbfilename.isEmpty())
+        return false;
+
+    MsgLog::information(QString("Building the tree of ")+cdbfilename);
+
+    // CDB -> fsxl -> tree, as readCdbFile always did
+    treeWidget->clear();
+    isTreeBuilt = this->readCdbFile(cdbfilename);
+
+    treeWidget->setColumnCount(2);
+    treeWidget->resizeColumnToContents(1);
+    treeWidget->resizeColumnToContents(0);
+
+    return isTreeBuilt;
+}
+
+
 bool Solid3DFileManager::read(QIODevice *device)
 {
     rxml.setDevice(device);
@@ -479,10 +513,10 @@ bool Solid3DFileManager::readCdbFile(QString filename)
 
     // ###########################  READING CDB FILE
 
-    QTextStream text(&cdbfile);
-
-    QString line;
-    QStringList str;
+    // the fields are parsed in place, the mapped file replaces the stream
+    cdbfile.close();
+    CdbTokenizer tokens;
+    tokens.open(cdbfile.fileName().toStdString());
 
     QStringList *strNodes;
     int nstrNodes;
@@ -534,28 +568,24 @@ bool Solid3DFileManager::readCdbFile(QString filename)
     QString pressure;
 
 
-    do {
-        line = text.readLine();
-        if(line.isNull())
-            break;
-        str = line.split(",", QString::SkipEmptyParts);
-
-        if(str[0]=="NUMOFF")
+    while(tokens.readLine())
+    {
+        if(tokens.is(0, "NUMOFF"))
         {
-            if(str[1]=="NODE")
+            if(tokens.is(1, "NODE"))
             {
-                nstrNodes = str[2].toInt();
+                nstrNodes = tokens.toInt(2);
                 strNodes = new QStringList[nstrNodes];
             }
-            else if(str[1]=="ELEM")
+            else if(tokens.is(1, "ELEM"))
             {
-                nstrElements = str[2].toInt();
+                nstrElements = tokens.toInt(2);
                 strElements = new QStringList[nstrElements];
 
             }
-            else if(str[1]=="MAT ")
+            else if(tokens.is(1, "MAT "))
             {
-                nstrMaterials= str[2].toInt();
+                nstrMaterials= tokens.toInt(2);
                 strMaterials = new QStringList[nstrMaterials];
 
                 for(int i=0; i<nstrMaterials; i++)
@@ -566,95 +596,88 @@ bool Solid3DFileManager::readCdbFile(QString filename)
             }
         }
 
-        if(str[0]=="MP")
+        if(tokens.is(0, "MP"))
         {
             do {
-                int index = str[2].toInt()-1;
-
-                if(str[1]=="DENS")
-                    strMaterials[index] << str[3];
-                else if(str[1]=="EX")
-                    strMaterials[index] << str[3];
-                else if(str[1]=="PRXY")
-                    strMaterials[index] << str[3];
-
-                line = text.readLine();
-                str = line.split(",", QString::SkipEmptyParts);
-            }while(str[0]=="MP");
+                int index = tokens.toInt(2)-1;
+
+                if(tokens.is(1, "DENS"))
+                    strMaterials[index] << QString::fromStdString(tokens.toString(3));
+                else if(tokens.is(1, "EX"))
+                    strMaterials[index] << QString::fromStdString(tokens.toString(3));
+                else if(tokens.is(1, "PRXY"))
+                    strMaterials[index] << QString::fromStdString(tokens.toString(3));
+
+                tokens.readLine();
+            }while(tokens.is(0, "MP"));
         }
 
-        if(str[0]=="N")
+        if(tokens.is(0, "N"))
         {
             for(int i=0; i<nstrNodes+1; i++)
             {
-                if(str[0] != "N")
+                if(!tokens.is(0, "N"))
                     break;
-                if(str[3].toInt()-1 != i) std::cerr<<"error in nodes indexing";
+                if(tokens.toInt(3)-1 != i) std::cerr<<"error in nodes indexing";
 
                 strNodes[i] << QString("%1").arg(i); // index
-                strNodes[i] << str[4]; // x
-                strNodes[i] << str[5]; // y
-                strNodes[i] << str[6]; // z
+                strNodes[i] << QString::fromStdString(tokens.toString(4)); // x
+                strNodes[i] << QString::fromStdString(tokens.toString(5)); // y
+                strNodes[i] << QString::fromStdString(tokens.toString(6)); // z
                 strNodes[i] << QString("0"); // restriction
                 strNodes[i] << QString("0"); // loading
                 strNodes[i] << QString("0"); // displacement
 
-                line = text.readLine();
-                str = line.split(",", QString::SkipEmptyParts);
+                tokens.readLine();
             }
         }
 
-        if(str[0]=="EN")
+        if(tokens.is(0, "EN"))
         {
             int ima;
             for(int i=0; i<nstrElements+1; i++)
             {
-                str = line.split(",", QString::SkipEmptyParts);
-                if(str[0] != "EN")
+                if(!tokens.is(0, "EN"))
                     break;
 
-                ima = str[4].toInt()-1;
-                if(str[7].toInt()-1 != i) std::cerr<<"error in elements indexing";
+                ima = tokens.toInt(4)-1;
+                if(tokens.toInt(7)-1 != i) std::cerr<<"error in elements indexing";
 
-                line = text.readLine();
-                str = line.split(",", QString::SkipEmptyParts);
+                tokens.readLine();
 
                 strElements[i] << QString("%1").arg(i); // index
-                strElements[i] << QString("%1").arg(str[3].toInt()-1); // node0
-                strElements[i] << QString("%1").arg(str[4].toInt()-1); // node1
-                strElements[i] << QString("%1").arg(str[5].toInt()-1); // node2
-                strElements[i] << QString("%1").arg(str[6].toInt()-1); // node3
+                strElements[i] << QString("%1").arg(tokens.toInt(3)-1); // node0
+                strElements[i] << QString("%1").arg(tokens.toInt(4)-1); // node1
+                strElements[i] << QString("%1").arg(tokens.toInt(5)-1); // node2
+                strElements[i] << QString("%1").arg(tokens.toInt(6)-1); // node3
                 strElements[i] << QString("%1").arg(ima); // material
                 strElements[i] << QString("-1"); // pface
                 strElements[i] << QString("0"); // pressure
 
-                line = text.readLine();
-                //str = line.split(",", QString::SkipEmptyParts);
+                tokens.readLine();
             }
         }
 
-        if(str[0]=="SFE")
+        if(tokens.is(0, "SFE"))
         {
             int iel;
             do {
-                iel = str[1].toInt()-1;
+                iel = tokens.toInt(1)-1;
                 //qDebug()<<iel;
 
-                strElements[iel][6] = QString("%1").arg(str[2].toInt()-1); // pface
+                strElements[iel][6] = QString("%1").arg(tokens.toInt(2)-1); // pface
 
-                line = text.readLine();
-                str = line.split(",", QString::SkipEmptyParts);
+                tokens.readLine();
 
                 // TODO implement for multiple inputs
-                pressure = str[0];
+                pressure = QString::fromStdString(tokens.toString(0));
                 strElements[iel][7] = QString("1"); // pressure
 
-                line = text.readLine();
-                str = line.split(",", QString::SkipEmptyParts);
-            }while(str[0]=="SFE");
+                tokens.readLine();
+            }while(tokens.is(0, "SFE"));
         }
 
-        if(str[0]=="D")
+        if(tokens.is(0, "D"))
         {
             // TODO implement for multiple inputs
             strRestrictions[1] << QString("1");
@@ -664,25 +687,22 @@ bool Solid3DFileManager::readCdbFile(QString filename)
             cstrRestrictions=2;
 
             strDisplacements[1] << QString("1");
-            strDisplacements[1] << str[3];
+            strDisplacements[1] << QString::fromStdString(tokens.toString(3));
             strDisplacements[1] << QString("0");
             strDisplacements[1] << QString("0");
             cstrDisplacements=2;
 
             int inode;
             do {
-                inode = str[1].toInt()-1;
+                inode = tokens.toInt(1)-1;
                 strNodes[inode][4] = QString("1");
                 strNodes[inode][6] = QString("1");
 
-                line = text.readLine();
-                if(line.isNull())
+                if(!tokens.readLine())
                     break;
-
-                str = line.split(",", QString::SkipEmptyParts);
-            }while(str[0]=="D");
+            }while(tokens.is(0, "D"));
         }
-    } while (!line.isNull());
+    }
 
     // ###########################  END READING CDB FILE
 
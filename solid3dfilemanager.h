@@ -39,6 +39,7 @@ public:
 
     bool openFile(void);
     bool saveFile(void);
+    bool buildTree(void);
     bool readFsxlFile(QString filename);
     bool readCdbFile(QString filename);
 
@@ -48,6 +49,11 @@ public:
 
     QString currentfilename;
 
+    // a CDB file is loaded straight into Solid3D: its tree (and the fsxl
+    // file) are only built when needed, from cdbfilename
+    QString cdbfilename;
+    bool isTreeBuilt;
+
     friend class Solid3DReader;
 
 private:
@@ -0,0 +1,224 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "solid3doperator.h"
+#include "solid3d.h"
+
+#include <algorithm>
+
+Solid3DOperator::Solid3DOperator(const Solid3D *mesh)
+{
+    this->mesh = mesh;
+    n = mesh->dofs.nFree;
+
+    D.resize(36*size_t(mesh->nma));
+    for(int m=0; m<mesh->nma; m++)
+        for(int i=0; i<6; i++)
+            for(int j=0; j<6; j++)
+                D[36*m+6*i+j] = mesh->materials[m]->D(i,j);
+
+    material = mesh->storage.materialIds;
+}
+
+
+int Solid3DOperator::size(void) const
+{
+    return n;
+}
+
+
+void Solid3DOperator::multiply(const double *x, double *y) const
+{
+    std::fill(y, y+n, 0.0);
+
+    const int *connectivity = mesh->connectivity.data();
+    const int *equation = mesh->dofs.equation.data();
+    const int *colorptr = mesh->colorptr.data();
+    const int *colorElements = mesh->colorElements.data();
+
+    // elements of the same colour do not share rows of y
+#pragma omp parallel
+    for(int c=0; c<mesh->nColors; c++)
+    {
+#pragma omp for schedule(static)
+        for(int t=colorptr[c]; t<colorptr[c+1]; t++)
+        {
+            int iel = colorElements[t];
+            const Solid3DElement *element = mesh->elements[iel];
+            const double *b = element->b, *cc = element->c, *d = element->d;
+            const double *De = &D[36*material[iel]];
+
+            // restricted dofs do not take part in the reduced product
+            int eq[12];
+            double xe[12];
+            for(int i=0; i<4; i++)
+                for(int ii=0; ii<3; ii++)
+                {
+                    eq[3*i+ii] = equation[3*connectivity[4*iel+i]+ii];
+                    xe[3*i+ii] = eq[3*i+ii]>=0? x[eq[3*i+ii]] : 0.0;
+                }
+
+            // strains = B*xe, stresses = V*D*strains
+            double e[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+            for(int i=0; i<4; i++)
+            {
+                e[0] += b[i]*xe[3*i];
+                e[1] += cc[i]*xe[3*i+1];
+                e[2] += d[i]*xe[3*i+2];
+                e[3] += cc[i]*xe[3*i] + b[i]*xe[3*i+1];
+                e[4] += d[i]*xe[3*i+1] + cc[i]*xe[3*i+2];
+                e[5] += d[i]*xe[3*i] + b[i]*xe[3*i+2];
+            }
+
+            double s[6];
+            for(int i=0; i<6; i++)
+            {
+                s[i] = 0.0;
+                for(int j=0; j<6; j++)
+                    s[i] += De[6*i+j]*e[j];
+                s[i] *= element->V;
+            }
+
+            // y += Bt*s
+            for(int i=0; i<4; i++)
+            {
+                double ye[3];
+                ye[0] = b[i]*s[0] + cc[i]*s[3] + d[i]*s[5];
+                ye[1] = cc[i]*s[1] + b[i]*s[3] + d[i]*s[4];
+                ye[2] = d[i]*s[2] + cc[i]*s[4] + b[i]*s[5];
+
+                for(int ii=0; ii<3; ii++)
+                    if(eq[3*i+ii] >= 0)
+                        y[eq[3*i+ii]] += ye[ii];
+            }
+        }
+    }
+}
+
+
+void Solid3DOperator::diagonal(double *diag) const
+{
+    std::fill(diag, diag+n, 0.0);
+
+    const int *connectivity = mesh->connectivity.data();
+    const int *equation = mesh->dofs.equation.data();
+    const int *colorptr = mesh->colorptr.data();
+    const int *colorElements = mesh->colorElements.data();
+
+#pragma omp parallel
+    for(int c=0; c<mesh->nColors; c++)
+    {
+#pragma omp for schedule(static)
+        for(int t=colorptr[c]; t<colorptr[c+1]; t++)
+        {
+            int iel = colorElements[t];
+            const Solid3DElement *element = mesh->elements[iel];
+            const double *De = &D[36*material[iel]];
+
+            for(int i=0; i<4; i++)
+            {
+                double bi = element->b[i], ci = element->c[i], di = element->d[i];
+
+                // nonzero column of B for each dof of node i
+                double col[3][6] = {{bi, 0.0, 0.0, ci, 0.0, di},
+                                    {0.0, ci, 0.0, bi, di, 0.0},
+                                    {0.0, 0.0, di, 0.0, ci, bi}};
+
+                for(int ii=0; ii<3; ii++)
+                {
+                    int eq = equation[3*connectivity[4*iel+i]+ii];
+                    if(eq < 0)
+                        continue;
+
+                    double kii = 0.0;
+                    for(int p=0; p<6; p++)
+                        for(int q=0; q<6; q++)
+                            kii += col[ii][p]*De[6*p+q]*col[ii][q];
+
+                    diag[eq] += element->V*kii;
+                }
+            }
+        }
+    }
+}
+
+
+void Solid3DOperator::diagonalBlocks(const int *blockptr, int nBlocks, double *blocks) const
+{
+    std::fill(blocks, blocks+9*size_t(nBlocks), 0.0);
+
+    const int *connectivity = mesh->connectivity.data();
+    const int *equation = mesh->dofs.equation.data();
+    const int *colorptr = mesh->colorptr.data();
+    const int *colorElements = mesh->colorElements.data();
+
+#pragma omp parallel
+    for(int c=0; c<mesh->nColors; c++)
+    {
+#pragma omp for schedule(static)
+        for(int t=colorptr[c]; t<colorptr[c+1]; t++)
+        {
+            int iel = colorElements[t];
+            const Solid3DElement *element = mesh->elements[iel];
+            const double *De = &D[36*material[iel]];
+
+            for(int i=0; i<4; i++)
+            {
+                double bi = element->b[i], ci = element->c[i], di = element->d[i];
+
+                double col[3][6] = {{bi, 0.0, 0.0, ci, 0.0, di},
+                                    {0.0, ci, 0.0, bi, di, 0.0},
+                                    {0.0, 0.0, di, 0.0, ci, bi}};
+
+                // block of node i: its free dofs are consecutive equations
+                int eq[3], first = -1;
+                for(int ii=0; ii<3; ii++)
+                {
+                    eq[ii] = equation[3*connectivity[4*iel+i]+ii];
+                    if(first<0 && eq[ii]>=0)
+                        first = eq[ii];
+                }
+                if(first < 0)
+                    continue;
+
+                int k = int(std::upper_bound(blockptr, blockptr+nBlocks+1, first) - blockptr) - 1;
+                double *block = blocks + 9*size_t(k);
+
+                for(int ii=0; ii<3; ii++)
+                    for(int jj=0; jj<3; jj++)
+                    {
+                        if(eq[ii]<0 || eq[jj]<0)
+                            continue;
+
+                        double kij = 0.0;
+                        for(int p=0; p<6; p++)
+                            for(int q=0; q<6; q++)
+                                kij += col[ii][p]*De[6*p+q]*col[jj][q];
+
+                        block[3*(eq[ii]-blockptr[k])+eq[jj]-blockptr[k]] += element->V*kij;
+                    }
+            }
+        }
+    }
+}
+
+
+double Solid3DOperator::memory(void) const
+{
+    // element data (b, c, d, V), connectivity and colours
+    double bytes = double(mesh->nElements)*(13*sizeof(double) + 6*sizeof(int)) + double(mesh->dofs.nDofs)*sizeof(int);
+    return bytes/(1024.*1024.);
+}
@@ -0,0 +1,54 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef SOLID3DOPERATOR_H
+#define SOLID3DOPERATOR_H
+
+#include "linearoperator.h"
+
+#include <vector>
+
+class Solid3D;
+
+///
+/// \brief The Solid3DOperator class
+/// Matrix-free stiffness operator: K*x is applied element by element from
+/// the B coefficients cached in each Solid3DElement and the D matrix of its
+/// material, so the global matrix is never assembled. Elements are swept
+/// colour by colour, as in the assembly. It acts on the free dofs only
+/// (the reduced system of the mesh DofMap).
+///
+class Solid3DOperator : public LinearOperator
+{
+public:
+    Solid3DOperator(const Solid3D *mesh);
+
+    int size(void) const;
+    void multiply(const double *x, double *y) const;
+    void diagonal(double *d) const;
+    void diagonalBlocks(const int *blockptr, int nBlocks, double *blocks) const;
+
+    double memory(void) const; // MB
+
+private:
+    const Solid3D *mesh;
+    int n;
+
+    std::vector<double> D;         // 6x6 matrix of each material
+    std::vector<int> material; // material of each element
+};
+
+#endif // SOLID3DOPERATOR_H
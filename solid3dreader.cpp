@@ -16,6 +16,7 @@
 
 #include <QtWidgets>
 #include "solid3dreader.h"
+#include "msglog.h"
 
 
 Solid3DReader::Solid3DReader(Solid3D *parent)
@@ -27,15 +28,25 @@ Solid3DReader::Solid3DReader(Solid3D *parent)
 
 Solid3D* Solid3DReader::read(Solid3DFileManager *solid3dfile)
 {
-    QFile file(solid3dfile->currentfilename);
+    // no tree yet: the model is still the one of the CDB file
+    bool isCdb = !solid3dfile->isTreeBuilt && !solid3dfile->cdbfilename.isEmpty();
+    QString filename = isCdb? solid3dfile->cdbfilename : solid3dfile->currentfilename;
+
+    QFile file(filename);
     if (!file.open(QFile::ReadOnly | QFile::Text)) {
         QMessageBox::warning(solid3dfile->treeWidget->parentWidget(), QObject::tr("Solid3D File Manager"),
                              QObject::tr("Cannot open file %1:\n%2.")
-                             .arg(solid3dfile->currentfilename)
+                             .arg(filename)
                              .arg(file.errorString()));
         return nullptr;
     }
 
+    if(isCdb)
+    {
+        file.close();
+        return readCdb(filename);
+    }
+
     xml.setDevice(&file);
 
     if (xml.readNextStartElement()) {
@@ -49,6 +60,44 @@ Solid3D* Solid3DReader::read(Solid3DFileManager *solid3dfile)
 }
 
 
+Solid3D* Solid3DReader::readCdb(QString filename)
+{
+    // single pass CDB -> Solid3D, without the fsxl file and the tree
+    QElapsedTimer timer;
+    timer.start();
+
+    Solid3D *previous = mesh;
+    mesh = new Solid3D(filename);
+    mesh->isMounted = true;
+
+    // nothing usable was read: the previous model is kept
+    if(mesh->nNodes == 0 || mesh->nElements == 0)
+    {
+        MsgLog::error(QString("No nodes or elements in %1").arg(filename));
+        delete mesh;
+        mesh = previous;
+        return nullptr;
+    }
+
+    adopt(previous);
+
+    MsgLog::information(QString("CDB file read in %1 s").arg(timer.elapsed()/1000.));
+    return this->mesh;
+}
+
+
+void Solid3DReader::adopt(Solid3D *previous)
+{
+    if(previous)
+    {
+        if(mesh->adoptStiffnessPattern(previous))
+            MsgLog::information(QString("Stiffness matrix pattern reused"));
+        mesh->solver.adoptFactorization(previous->solver);
+        delete previous;
+    }
+}
+
+
 QString Solid3DReader::errorString() const
 {
     return QObject::tr("%1\nLine %2, column %3")
@@ -65,7 +114,7 @@ void Solid3DReader::readXML()
     while (xml.readNextStartElement()) {
         if(xml.name() == "mesh")
         {
-            if(mesh) delete mesh;
+            Solid3D *previous = mesh;
             mesh = new Solid3D;
 
             while (xml.readNextStartElement())
@@ -94,6 +143,7 @@ void Solid3DReader::readXML()
             }
 
             mesh->isMounted = true;
+            adopt(previous);
         }
     }
 }
@@ -256,7 +306,7 @@ void Solid3DReader::readNodes(void)
     Q_ASSERT(xml.isStartElement() && xml.name() == "nodes");
 
     mesh->nNodes = xml.attributes().value("count").toInt();
-    mesh->nodes = new Node3D *[mesh->nNodes];
+    mesh->nodes = mesh->storage.allocateNodes(mesh->nNodes);
 
     int i = 0;
 
@@ -291,7 +341,7 @@ void Solid3DReader::readNodes(void)
                     xml.skipCurrentElement();
             }
 
-            mesh->nodes[i] = new Node3D(index, tempCoord, mesh->restrictions[tir], mesh->loading[til], mesh->displacements[tid]);
+            mesh->storage.setNode(i, index, tempCoord, mesh->restrictions[tir], mesh->loading[til], mesh->displacements[tid]);
             i++;
 
         }
@@ -306,7 +356,7 @@ void Solid3DReader::readElements(void)
     Q_ASSERT(xml.isStartElement() && xml.name() == "elements");
 
     mesh->nElements = xml.attributes().value("count").toInt();
-    mesh->elements = new Solid3DElement *[mesh->nElements];
+    mesh->elements = mesh->storage.allocateElements(mesh->nElements);
 
     int i = 0;
 
@@ -343,8 +393,8 @@ void Solid3DReader::readElements(void)
                 else
                     xml.skipCurrentElement();
             }
-            mesh->elements[i] = new  Solid3DElement(index, mesh->nodes[inode0], mesh->nodes[inode1],
-                                                    mesh->nodes[inode2], mesh->nodes[inode3],  mesh->materials[itm]);
+            mesh->storage.setElement(i, index, mesh->nodes[inode0], mesh->nodes[inode1],
+                                     mesh->nodes[inode2], mesh->nodes[inode3], mesh->materials, itm);
             mesh->elements[i]->pface = iface;
             if(pressure == 0)
             mesh->elements[i]->pressure = &mesh->pressure0;
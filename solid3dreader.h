@@ -32,10 +32,12 @@ public:
     Solid3D *mesh;
 
     Solid3D* read(Solid3DFileManager *file);
+    Solid3D* readCdb(QString filename);
 
     QString errorString() const;
 
 private:
+    void adopt(Solid3D *previous);
     void readXML();
     void readBoundaryConditions(void);
     void readLoading(void);
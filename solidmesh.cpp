@@ -0,0 +1,146 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "solidmesh.h"
+
+SolidMesh::SolidMesh()
+{
+    nNodes = 0;
+    nElements = 0;
+    nodeBlock = nullptr;
+    elementBlock = nullptr;
+}
+
+
+SolidMesh::~SolidMesh()
+{
+    releaseElements();
+    releaseNodes();
+}
+
+
+void SolidMesh::releaseNodes(void)
+{
+    // the arrays of the nodes belong to the mesh, not to the nodes
+    for(int i=0; i<nNodes; i++)
+    {
+        nodeBlock[i].coordinates = nullptr;
+        nodeBlock[i].loading = nullptr;
+    }
+
+    delete [] nodeBlock;
+    nodeBlock = nullptr;
+}
+
+
+void SolidMesh::releaseElements(void)
+{
+    for(int i=0; i<nElements; i++)
+    {
+        elementBlock[i].nodes = nullptr;
+        elementBlock[i].normals = nullptr;
+        elementBlock[i].areas = nullptr;
+    }
+
+    delete [] elementBlock;
+    elementBlock = nullptr;
+}
+
+
+Node3D **SolidMesh::allocateNodes(int nNodes)
+{
+    releaseNodes();
+
+    this->nNodes = nNodes;
+    coordinates.assign(3*size_t(nNodes), 0.0);
+    loading.assign(3*size_t(nNodes), 0.0);
+    nodeBlock = new Node3D[nNodes];
+
+    Node3D **nodes = new Node3D*[nNodes];
+    for(int i=0; i<nNodes; i++)
+    {
+        nodeBlock[i].index = i;
+        nodeBlock[i].coordinates = &coordinates[3*size_t(i)];
+        nodeBlock[i].loading = &loading[3*size_t(i)];
+        nodeBlock[i].restrictions = nullptr;
+        nodeBlock[i].displacements = nullptr;
+        nodes[i] = nodeBlock+i;
+    }
+
+    return nodes;
+}
+
+
+Solid3DElement **SolidMesh::allocateElements(int nElements)
+{
+    releaseElements();
+
+    this->nElements = nElements;
+    connectivity.assign(4*size_t(nElements), 0);
+    materialIds.assign(nElements, 0);
+    normals.assign(4*size_t(nElements), QVector3D());
+    areas.assign(4*size_t(nElements), 0.0);
+    elementNodes.assign(4*size_t(nElements), nullptr);
+    elementBlock = new Solid3DElement[nElements];
+
+    Solid3DElement **elements = new Solid3DElement*[nElements];
+    for(int i=0; i<nElements; i++)
+    {
+        elementBlock[i].index = i;
+        elementBlock[i].nodes = &elementNodes[4*size_t(i)];
+        elementBlock[i].normals = &normals[4*size_t(i)];
+        elementBlock[i].areas = &areas[4*size_t(i)];
+        elements[i] = elementBlock+i;
+    }
+
+    return elements;
+}
+
+
+Node3D *SolidMesh::setNode(int i, int index, const double *coordinates, bool *restrictions,
+                           const double *loading, double *displacements)
+{
+    Node3D *node = nodeBlock+i;
+    node->index = index;
+    node->restrictions = restrictions;
+    node->displacements = displacements;
+    for(int j=0; j<3; j++)
+    {
+        node->coordinates[j] = coordinates[j];
+        node->loading[j] = loading[j];
+    }
+
+    return node;
+}
+
+
+Solid3DElement *SolidMesh::setElement(int i, int index, Node3D *node0, Node3D *node1, Node3D *node2, Node3D *node3,
+                                      Material **materials, int materialId)
+{
+    Solid3DElement *element = elementBlock+i;
+    element->index = index;
+    element->nodes[0] = node0;
+    element->nodes[1] = node1;
+    element->nodes[2] = node2;
+    element->nodes[3] = node3;
+    element->material = materials[materialId];
+
+    for(int j=0; j<4; j++)
+        connectivity[4*size_t(i)+j] = element->nodes[j]->index;
+    materialIds[i] = materialId;
+
+    return element;
+}
@@ -0,0 +1,70 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef SOLIDMESH_H
+#define SOLIDMESH_H
+
+#include "node3d.h"
+#include "solid3delement.h"
+#include "material.h"
+
+#include <vector>
+#include <QVector3D>
+
+///
+/// \brief The SolidMesh class
+/// Contiguous storage of a tetrahedral mesh: coordinates and loads of the
+/// nodes (x, y, z one after the other), packed connectivity (4 node indices
+/// per element), material of each element and the face normals and areas.
+/// The Node3D and Solid3DElement objects of a Solid3D are allocated here in
+/// two blocks and their arrays point into this storage, so that building a
+/// mesh makes no allocation per node or element and the loops over the
+/// whole mesh read the flat arrays.
+///
+class SolidMesh
+{
+public:
+    int nNodes;
+    int nElements;
+
+    std::vector<double> coordinates; // 3 per node
+    std::vector<double> loading;     // 3 per node
+    std::vector<int> connectivity;   // 4 per element
+    std::vector<int> materialIds;    // 1 per element
+    std::vector<QVector3D> normals;  // 4 faces per element
+    std::vector<double> areas;       // 4 faces per element
+
+    SolidMesh();
+    ~SolidMesh();
+
+    Node3D **allocateNodes(int nNodes);
+    Solid3DElement **allocateElements(int nElements);
+
+    Node3D *setNode(int i, int index, const double *coordinates, bool *restrictions,
+                    const double *loading, double *displacements);
+    Solid3DElement *setElement(int i, int index, Node3D *node0, Node3D *node1, Node3D *node2, Node3D *node3,
+                               Material **materials, int materialId);
+
+private:
+    Node3D *nodeBlock;
+    Solid3DElement *elementBlock;
+    std::vector<Node3D*> elementNodes; // 4 per element
+
+    void releaseNodes(void);
+    void releaseElements(void);
+};
+
+#endif // SOLIDMESH_H
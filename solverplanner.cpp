@@ -0,0 +1,213 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "solverplanner.h"
+#include "sparsecholesky.h"
+#include "msglog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <string>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// share of the available memory a solver may take
+#define PLANNER_MEMORY_FRACTION 0.5
+// multiply-adds per second and thread of the supernodal Cholesky
+#define PLANNER_FACTOR_RATE 6.e9
+// AMG: setup and iteration time per nonzero of k, typical iterations
+#define PLANNER_AMG_SETUP_COST 4.5e-7
+#define PLANNER_AMG_ITERATION_COST 1.5e-8
+#define PLANNER_AMG_ITERATIONS 60
+// matrix-free block Jacobi: iteration time per element
+#define PLANNER_MATRIXFREE_ITERATION_COST 1.4e-7
+
+static double availablePhysicalMemory(void)
+{
+    // -1: unknown, only the time estimates are used
+#ifndef _WIN32
+    // MemAvailable counts the page cache the kernel can reclaim
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key;
+    double value;
+    while(meminfo >> key >> value)
+    {
+        if(key == "MemAvailable:")
+            return value/1024.;
+        meminfo.ignore(256, '\n');
+    }
+
+    long pages = sysconf(_SC_AVPHYS_PAGES), pageSize = sysconf(_SC_PAGESIZE);
+    if(pages > 0 && pageSize > 0)
+        return double(pages)*pageSize/1048576.;
+#endif
+
+    return -1.0;
+}
+
+
+SolverPlanner::SolverPlanner()
+{
+    method = sparseDirect;
+    direct = LinearSolver::sparseCholesky;
+    preconditioning = LinearSolver::smoothedAggregation;
+
+    nFree = 0;
+    nElements = 0;
+    nnz = 0;
+    factorNnz = 0;
+    factorFlops = 0;
+
+    nThreads = 1;
+#ifdef _OPENMP
+    nThreads = omp_get_max_threads();
+#endif
+    availableMemory = availablePhysicalMemory();
+
+    predictedTime = 0.0;
+    predictedMemory = 0.0;
+}
+
+
+void SolverPlanner::evalMatrixSize(int nNodes, const int *connectivity, int nElements, int nodesPerElement, int nFree)
+{
+    this->nFree = nFree;
+    this->nElements = nElements;
+
+    // edges of the node graph: each one is two 3x3 blocks of k
+    std::vector<long long> edges;
+    edges.reserve(size_t(nElements)*nodesPerElement*(nodesPerElement-1)/2);
+    for(int iel=0; iel<nElements; iel++)
+    {
+        const int *enodes = connectivity + iel*nodesPerElement;
+        for(int i=0; i<nodesPerElement; i++)
+            for(int j=i+1; j<nodesPerElement; j++)
+                edges.push_back((long long)(std::min(enodes[i], enodes[j]))*nNodes + std::max(enodes[i], enodes[j]));
+    }
+
+    std::sort(edges.begin(), edges.end());
+    long long nEdges = std::unique(edges.begin(), edges.end())-edges.begin();
+
+    // restricted dofs remove their rows and columns
+    double ratio = nNodes>0? nFree/(3.0*nNodes) : 0.0;
+    nnz = (long long)(9.0*(nNodes+2*nEdges)*ratio*ratio);
+}
+
+
+double SolverPlanner::assembledMemory(void) const
+{
+    // k (values, columns) and the scatter map of the assembly
+    return (12.0*nnz + 576.0*nElements)/1048576.;
+}
+
+
+bool SolverPlanner::fits(double memory) const
+{
+    return availableMemory < 0.0 || memory < PLANNER_MEMORY_FRACTION*availableMemory;
+}
+
+
+bool SolverPlanner::isAssemblyAffordable(void) const
+{
+    // the cheapest assembled solver: k plus about the same for AMG
+    return fits(2.5*assembledMemory());
+}
+
+
+void SolverPlanner::evalFactorSize(const SparseMatrix &k, const std::vector<int> &blockptr)
+{
+    nnz = k.nnz;
+
+    SparseCholesky cholesky;
+    cholesky.analysePattern(k, blockptr);
+    factorNnz = cholesky.nnz();
+    factorFlops = cholesky.flops();
+}
+
+
+double SolverPlanner::speedup(void) const
+{
+    return 1.0 + 0.7*(nThreads-1);
+}
+
+
+void SolverPlanner::choose(void)
+{
+    const double vectors = 10.0*8.0*nFree/1048576.;
+
+    MsgLog::information(QString("Solver planner: %1 free dof, %2 nonzeros, %3 threads, %4")
+                        .arg(nFree).arg(nnz).arg(nThreads)
+                        .arg(availableMemory<0.0? QString("unknown memory") : QString("%1 MB available").arg(availableMemory, 0, 'f', 0)));
+
+    // matrix-free block Jacobi: always fits, the iterations grow quickly
+    // with the size and the slenderness of the model
+    method = matrixFree;
+    direct = LinearSolver::sparseCholesky;
+    preconditioning = LinearSolver::blockJacobi;
+    predictedMemory = vectors;
+    predictedTime = PLANNER_MATRIXFREE_ITERATION_COST*nElements*20.0*cbrt(double(nFree))/speedup();
+    QString report = QString("matrix-free %1 s, %2 MB").arg(predictedTime, 0, 'g', 2).arg(predictedMemory, 0, 'g', 3);
+
+    if(factorNnz > 0)
+    {
+        double timeAMG = nnz*(PLANNER_AMG_SETUP_COST + PLANNER_AMG_ITERATIONS*PLANNER_AMG_ITERATION_COST)/speedup();
+        double memoryAMG = 2.5*assembledMemory() + vectors;
+        report += QString("; PCG (AMG) %1 s, %2 MB").arg(timeAMG, 0, 'g', 2).arg(memoryAMG, 0, 'g', 3);
+        if(fits(memoryAMG) && timeAMG < predictedTime)
+        {
+            method = iterative;
+            preconditioning = LinearSolver::smoothedAggregation;
+            predictedTime = timeAMG;
+            predictedMemory = memoryAMG;
+        }
+
+        // transient fronts add about a third to the factor; the single
+        // precision factor only when the double one does not fit
+        double timeDirect = factorFlops/(PLANNER_FACTOR_RATE*speedup());
+        double memoryDirect = assembledMemory() + 1.3*8.0*factorNnz/1048576.;
+        LinearSolver::Direct cholesky = LinearSolver::sparseCholesky;
+        if(!fits(memoryDirect))
+        {
+            timeDirect *= 0.6;
+            memoryDirect = assembledMemory() + 1.3*4.0*factorNnz/1048576.;
+            cholesky = LinearSolver::mixedCholesky;
+        }
+
+        report += QString("; %1 sparse Cholesky %2 s, %3 MB (factor %4 nonzeros, %5 flops)")
+                  .arg(cholesky==LinearSolver::mixedCholesky? "mixed precision" : "double precision")
+                  .arg(timeDirect, 0, 'g', 2).arg(memoryDirect, 0, 'g', 3).arg(factorNnz).arg(double(factorFlops), 0, 'g', 3);
+        if(fits(memoryDirect) && timeDirect <= predictedTime)
+        {
+            method = sparseDirect;
+            direct = cholesky;
+            predictedTime = timeDirect;
+            predictedMemory = memoryDirect;
+        }
+    }
+    MsgLog::information(QString("Solver planner, predicted: %1").arg(report));
+
+    QString name = method==sparseDirect? (direct==LinearSolver::mixedCholesky? "mixed precision sparse Cholesky" : "sparse Cholesky")
+                 : method==iterative? "PCG with AMG" : "matrix-free PCG with block Jacobi";
+    MsgLog::information(QString("Solver planner: %1 chosen, predicted %2 s and %3 MB")
+                        .arg(name).arg(predictedTime, 0, 'g', 2).arg(predictedMemory, 0, 'g', 3));
+}
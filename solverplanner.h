@@ -0,0 +1,67 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef SOLVERPLANNER_H
+#define SOLVERPLANNER_H
+
+#include "sparsematrix.h"
+#include "linearsolver.h"
+
+#include <vector>
+
+///
+/// \brief The SolverPlanner class
+/// Chooses the solver of a model from its size and the machine: the
+/// nonzeros of k (estimated from the node graph before any assembly), the
+/// fill and flops of the sparse Cholesky factor (symbolic analysis of the
+/// pattern), the available memory and the number of threads. Among the
+/// methods that fit in memory the one of smallest predicted time is used;
+/// the estimates and the decision are logged through MsgLog.
+///
+class SolverPlanner
+{
+public:
+    enum Method { sparseDirect, iterative, matrixFree };
+
+    Method method;
+    LinearSolver::Direct direct;
+    LinearSolver::Preconditioning preconditioning;
+
+    int nFree;
+    int nElements;
+    long long nnz;         // of k
+    long long factorNnz;   // of the Cholesky factor, 0 if not analysed
+    long long factorFlops;
+    int nThreads;
+    double availableMemory; // MB, -1 if unknown
+
+    double predictedTime;   // s
+    double predictedMemory; // MB
+
+    SolverPlanner();
+
+    void evalMatrixSize(int nNodes, const int *connectivity, int nElements, int nodesPerElement, int nFree);
+    bool isAssemblyAffordable(void) const;
+    void evalFactorSize(const SparseMatrix &k, const std::vector<int> &blockptr);
+    void choose(void);
+
+private:
+    double speedup(void) const;
+    double assembledMemory(void) const;
+    bool fits(double memory) const; // always true if the memory is unknown
+};
+
+#endif // SOLVERPLANNER_H
@@ -0,0 +1,616 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "sparsecholesky.h"
+
+#include <algorithm>
+#include <cmath>
+
+// parts of the node graph with fewer nodes are not dissected further
+#define DISSECTION_LEAF_SIZE 64
+// subtrees with less work (flops) are factorized in the task of their parent
+#define TASK_MIN_WORK 2000000LL
+
+SparseCholesky::SparseCholesky()
+{
+    n = 0;
+    failedEquation = -1;
+    isSinglePrecision = false;
+}
+
+
+bool SparseCholesky::factorize(const SparseMatrix &a, const std::vector<int> &blockptr)
+{
+    n = a.n;
+    failedEquation = -1;
+
+    order(a, blockptr);
+    analyse(a);
+
+    int failed = 0;
+    std::vector<double>().swap(lvalues);
+    std::vector<float>().swap(lvalues32);
+
+    // the virtual supernode nSupernodes() has the roots as children
+    if(isSinglePrecision)
+    {
+        lvalues32.assign(lptr.back(), 0.0f);
+        std::vector< std::vector<float> > updates(nSupernodes());
+#pragma omp parallel
+#pragma omp single
+        factorTree(nSupernodes(), lvalues32.data(), updates, failed);
+    }
+    else
+    {
+        lvalues.assign(lptr.back(), 0.0);
+        std::vector< std::vector<double> > updates(nSupernodes());
+#pragma omp parallel
+#pragma omp single
+        factorTree(nSupernodes(), lvalues.data(), updates, failed);
+    }
+
+    // the permuted copy of A is not needed by the solves
+    std::vector<int>().swap(acolptr);
+    std::vector<int>().swap(arowind);
+    std::vector<double>().swap(avalues);
+
+    return failed == 0;
+}
+
+
+void SparseCholesky::analysePattern(const SparseMatrix &a, const std::vector<int> &blockptr)
+{
+    n = a.n;
+    order(a, blockptr);
+    analyse(a);
+
+    std::vector<int>().swap(acolptr);
+    std::vector<int>().swap(arowind);
+    std::vector<double>().swap(avalues);
+}
+
+
+void SparseCholesky::order(const SparseMatrix &a, const std::vector<int> &blockptr)
+{
+    const int nBlocks = int(blockptr.size())-1;
+
+    // node graph: blocks coupled by a nonzero of a
+    std::vector<int> blockOf(n);
+    for(int k=0; k<nBlocks; k++)
+        for(int i=blockptr[k]; i<blockptr[k+1]; i++)
+            blockOf[i] = k;
+
+    std::vector<int> gptr(1, 0), gadj;
+    std::vector<int> mark(nBlocks, -1);
+    for(int k=0; k<nBlocks; k++)
+    {
+        for(int i=blockptr[k]; i<blockptr[k+1]; i++)
+            for(int p=a.rowptr[i]; p<a.rowptr[i+1]; p++)
+            {
+                int j = blockOf[a.colind[p]];
+                if(j!=k && mark[j]!=k)
+                {
+                    mark[j] = k;
+                    gadj.push_back(j);
+                }
+            }
+        gptr.push_back(int(gadj.size()));
+    }
+
+    // nested dissection: a part is split in two by the middle level set of
+    // a breadth-first search from a pseudo-peripheral node. Parts are
+    // numbered from the end: separator last, then the two halves.
+    std::vector<int> blockOrder(nBlocks), region(nBlocks, 0), level(nBlocks, -1);
+    std::vector<int> queue, count;
+    std::vector< std::vector<int> > parts(1);
+    int nRegions = 0, last = nBlocks;
+
+    for(int k=0; k<nBlocks; k++)
+        parts[0].push_back(k);
+
+    while(!parts.empty())
+    {
+        std::vector<int> part;
+        part.swap(parts.back());
+        parts.pop_back();
+
+        int id = ++nRegions;
+        for(size_t t=0; t<part.size(); t++)
+            region[part[t]] = id;
+
+        std::vector<int> partA, partB, separator;
+
+        if(part.size() > DISSECTION_LEAF_SIZE)
+        {
+            int root = part[0];
+            for(int sweep=0; sweep<2; sweep++)
+            {
+                for(size_t t=0; t<part.size(); t++)
+                    level[part[t]] = -1;
+
+                queue.assign(1, root);
+                level[root] = 0;
+                for(size_t q=0; q<queue.size(); q++)
+                {
+                    int v = queue[q];
+                    for(int p=gptr[v]; p<gptr[v+1]; p++)
+                    {
+                        int u = gadj[p];
+                        if(region[u]==id && level[u]<0)
+                        {
+                            level[u] = level[v]+1;
+                            queue.push_back(u);
+                        }
+                    }
+                }
+                root = queue.back();
+            }
+
+            int depth = level[queue.back()];
+
+            if(queue.size() < part.size())
+            {
+                // disconnected: the reached component against the others
+                for(size_t t=0; t<part.size(); t++)
+                    (level[part[t]]>=0? partA : partB).push_back(part[t]);
+            }
+            else if(depth >= 2)
+            {
+                count.assign(depth+1, 0);
+                for(size_t t=0; t<part.size(); t++)
+                    count[level[part[t]]]++;
+
+                int m = 0, below = 0;
+                while(m<depth-1 && below+count[m] < int(part.size())/2)
+                    below += count[m++];
+                m = std::max(m, 1);
+
+                // nodes of the middle level without neighbours above it
+                // stay in the lower half
+                for(size_t t=0; t<part.size(); t++)
+                {
+                    int v = part[t];
+                    if(level[v] < m)
+                        partA.push_back(v);
+                    else if(level[v] > m)
+                        partB.push_back(v);
+                    else
+                    {
+                        bool isCut = false;
+                        for(int p=gptr[v]; p<gptr[v+1] && !isCut; p++)
+                            if(region[gadj[p]]==id && level[gadj[p]]==m+1)
+                                isCut = true;
+                        (isCut? separator : partA).push_back(v);
+                    }
+                }
+            }
+        }
+
+        if(partA.empty() || partB.empty())
+        {
+            for(size_t t=part.size(); t-->0; )
+                blockOrder[--last] = part[t];
+            continue;
+        }
+
+        for(size_t t=separator.size(); t-->0; )
+            blockOrder[--last] = separator[t];
+        parts.push_back(partA);
+        parts.push_back(partB);
+    }
+
+    perm.clear();
+    for(int t=0; t<nBlocks; t++)
+        for(int i=blockptr[blockOrder[t]]; i<blockptr[blockOrder[t]+1]; i++)
+            perm.push_back(i);
+}
+
+
+void SparseCholesky::analyse(const SparseMatrix &a)
+{
+    std::vector<int> iperm(n);
+    for(int i=0; i<n; i++)
+        iperm[perm[i]] = i;
+
+    // elimination tree of the permuted matrix (Liu)
+    std::vector<int> parent(n, -1), ancestor(n, -1);
+    for(int i=0; i<n; i++)
+        for(int p=a.rowptr[perm[i]]; p<a.rowptr[perm[i]+1]; p++)
+        {
+            int k = iperm[a.colind[p]];
+            while(k!=-1 && k<i)
+            {
+                int next = ancestor[k];
+                ancestor[k] = i;
+                if(next == -1)
+                    parent[k] = i;
+                k = next;
+            }
+        }
+
+    // postorder, so that supernodes and subtrees are contiguous
+    std::vector<int> head(n, -1), next(n, -1), post, stack;
+    for(int j=n-1; j>=0; j--)
+        if(parent[j] != -1)
+        {
+            next[j] = head[parent[j]];
+            head[parent[j]] = j;
+        }
+
+    for(int j=0; j<n; j++)
+    {
+        if(parent[j] != -1)
+            continue;
+
+        stack.assign(1, j);
+        while(!stack.empty())
+        {
+            int v = stack.back();
+            if(head[v] != -1)
+            {
+                int c = head[v];
+                head[v] = next[c];
+                stack.push_back(c);
+            }
+            else
+            {
+                post.push_back(v);
+                stack.pop_back();
+            }
+        }
+    }
+
+    std::vector<int> ipost(n), postPerm(n), postParent(n);
+    for(int t=0; t<n; t++)
+        ipost[post[t]] = t;
+    for(int t=0; t<n; t++)
+    {
+        postPerm[t] = perm[post[t]];
+        postParent[t] = parent[post[t]]==-1? -1 : ipost[parent[post[t]]];
+    }
+    perm.swap(postPerm);
+    parent.swap(postParent);
+    for(int i=0; i<n; i++)
+        iperm[perm[i]] = i;
+
+    // lower triangle of the permuted matrix
+    acolptr.assign(1, 0);
+    arowind.clear();
+    avalues.clear();
+    for(int j=0; j<n; j++)
+    {
+        for(int p=a.rowptr[perm[j]]; p<a.rowptr[perm[j]+1]; p++)
+        {
+            int i = iperm[a.colind[p]];
+            if(i >= j)
+            {
+                arowind.push_back(i);
+                avalues.push_back(a.values[p]);
+            }
+        }
+        acolptr.push_back(int(arowind.size()));
+    }
+
+    // column counts of L from the row subtrees
+    std::vector<int> colCount(n, 1), mark(n, -1), nChildren(n, 0);
+    for(int i=0; i<n; i++)
+    {
+        mark[i] = i;
+        for(int p=a.rowptr[perm[i]]; p<a.rowptr[perm[i]+1]; p++)
+            for(int k=iperm[a.colind[p]]; k<i && mark[k]!=i; k=parent[k])
+            {
+                colCount[k]++;
+                mark[k] = i;
+            }
+    }
+
+    // fundamental supernodes: chains of single children with nested structure
+    for(int j=0; j<n; j++)
+        if(parent[j] != -1)
+            nChildren[parent[j]]++;
+
+    super.assign(1, 0);
+    for(int j=1; j<n; j++)
+        if(!(parent[j-1]==j && colCount[j-1]==colCount[j]+1 && nChildren[j]==1))
+            super.push_back(j);
+    super.push_back(n);
+
+    const int nSuper = nSupernodes();
+    std::vector<int> snode(n), sparent(nSuper);
+    for(int s=0; s<nSuper; s++)
+        for(int j=super[s]; j<super[s+1]; j++)
+            snode[j] = s;
+    for(int s=0; s<nSuper; s++)
+        sparent[s] = parent[super[s+1]-1]==-1? nSuper : snode[parent[super[s+1]-1]];
+
+    childptr.assign(nSuper+2, 0);
+    for(int s=0; s<nSuper; s++)
+        childptr[sparent[s]+1]++;
+    for(int s=0; s<=nSuper; s++)
+        childptr[s+1] += childptr[s];
+    children.resize(nSuper);
+    std::vector<int> fill(childptr.begin(), childptr.end()-1);
+    for(int s=0; s<nSuper; s++)
+        children[fill[sparent[s]]++] = s;
+
+    // row structure of each supernode: its columns, the rows of A below
+    // them and the update rows of its children
+    rowptr.assign(1, 0);
+    rows.clear();
+    lptr.assign(1, 0);
+    work.assign(nSuper+1, 0);
+    mark.assign(n, -1);
+
+    for(int s=0; s<nSuper; s++)
+    {
+        int f = super[s], l = super[s+1];
+        for(int j=f; j<l; j++)
+        {
+            rows.push_back(j);
+            mark[j] = s;
+        }
+
+        for(int j=f; j<l; j++)
+            for(int p=acolptr[j]; p<acolptr[j+1]; p++)
+                if(mark[arowind[p]] != s)
+                {
+                    mark[arowind[p]] = s;
+                    rows.push_back(arowind[p]);
+                }
+
+        for(int t=childptr[s]; t<childptr[s+1]; t++)
+        {
+            int c = children[t];
+            for(int p=rowptr[c]+super[c+1]-super[c]; p<rowptr[c+1]; p++)
+                if(mark[rows[p]] != s)
+                {
+                    mark[rows[p]] = s;
+                    rows.push_back(rows[p]);
+                }
+        }
+
+        std::sort(rows.begin()+rowptr[s]+(l-f), rows.end());
+        rowptr.push_back(int(rows.size()));
+
+        long long m = rowptr[s+1]-rowptr[s], k = l-f;
+        lptr.push_back(lptr.back() + m*k);
+        work[s] += k*m*m;
+        work[sparent[s]] += work[s];
+    }
+}
+
+
+template<typename real>
+void SparseCholesky::factorTree(int s, real *lfactor, std::vector< std::vector<real> > &updates, int &failed)
+{
+    for(int t=childptr[s]; t<childptr[s+1]; t++)
+    {
+        int c = children[t];
+#pragma omp task if(work[c] > TASK_MIN_WORK) shared(updates, failed)
+        factorTree(c, lfactor, updates, failed);
+    }
+#pragma omp taskwait
+
+    int isFailed;
+#pragma omp atomic read
+    isFailed = failed;
+
+    if(s<nSupernodes() && !isFailed && !factorSupernode(s, lfactor, updates))
+    {
+#pragma omp atomic write
+        failed = 1;
+    }
+}
+
+
+template<typename real>
+bool SparseCholesky::factorSupernode(int s, real *lfactor, std::vector< std::vector<real> > &updates)
+{
+    const int f = super[s], k = super[s+1]-f;
+    const int m = rowptr[s+1]-rowptr[s], mu = m-k;
+    const int *srows = rows.data()+rowptr[s];
+    real *L = lfactor+lptr[s]; // m x k
+
+    std::vector<real> &U = updates[s]; // mu x mu, lower triangle
+    U.assign(size_t(mu)*mu, real(0));
+
+    // assembly of A and extend-add of the children's updates
+    for(int j=0; j<k; j++)
+        for(int p=acolptr[f+j]; p<acolptr[f+j+1]; p++)
+        {
+            int i = int(std::lower_bound(srows, srows+m, arowind[p])-srows);
+            L[size_t(j)*m+i] += avalues[p];
+        }
+
+    std::vector<int> position;
+    for(int t=childptr[s]; t<childptr[s+1]; t++)
+    {
+        int c = children[t];
+        int kc = super[c+1]-super[c], mc = rowptr[c+1]-rowptr[c]-kc;
+        const int *crows = rows.data()+rowptr[c]+kc;
+        const real *Uc = updates[c].data();
+
+        position.resize(mc);
+        for(int q=0; q<mc; q++)
+            position[q] = int(std::lower_bound(srows, srows+m, crows[q])-srows);
+
+        for(int q=0; q<mc; q++)
+        {
+            int pq = position[q];
+            real *target = pq<k? L+size_t(pq)*m : U.data()+size_t(pq-k)*mu-k;
+            for(int r=q; r<mc; r++)
+                target[position[r]] += Uc[size_t(q)*mc+r];
+        }
+
+        std::vector<real>().swap(updates[c]);
+    }
+
+    // dense Cholesky of the panel: diagonal block and the rows below it
+    for(int j=0; j<k; j++)
+    {
+        real *lj = L+size_t(j)*m;
+        if(lj[j] <= real(0))
+        {
+#pragma omp critical
+            failedEquation = perm[f+j];
+            return false;
+        }
+
+        real d = std::sqrt(lj[j]);
+        lj[j] = d;
+        for(int i=j+1; i<m; i++)
+            lj[i] /= d;
+
+        for(int jj=j+1; jj<k; jj++)
+        {
+            real *ljj = L+size_t(jj)*m;
+            const real lk = lj[jj];
+#pragma omp simd
+            for(int i=jj; i<m; i++)
+                ljj[i] -= lj[i]*lk;
+        }
+    }
+
+    // Schur complement U -= L2*L2t, four columns of the panel at a time
+    const real *L2 = L+k;
+    real *u = U.data();
+#pragma omp taskloop if(double(mu)*mu*k > TASK_MIN_WORK) grainsize(16)
+    for(int q=0; q<mu; q++)
+    {
+        real *uq = u+size_t(q)*mu;
+        int p = 0;
+        for(; p+4<=k; p+=4)
+        {
+            const real *l0 = L2+size_t(p)*m, *l1 = l0+m, *l2 = l1+m, *l3 = l2+m;
+            const real s0 = l0[q], s1 = l1[q], s2 = l2[q], s3 = l3[q];
+#pragma omp simd
+            for(int i=q; i<mu; i++)
+                uq[i] -= l0[i]*s0 + l1[i]*s1 + l2[i]*s2 + l3[i]*s3;
+        }
+        for(; p<k; p++)
+        {
+            const real *l0 = L2+size_t(p)*m;
+            const real s0 = l0[q];
+#pragma omp simd
+            for(int i=q; i<mu; i++)
+                uq[i] -= l0[i]*s0;
+        }
+    }
+
+    return true;
+}
+
+
+void SparseCholesky::solve(const double *b, double *x, int nRhs) const
+{
+    // right-hand sides interleaved row by row: each entry of L updates all
+    // columns at once
+    const int nr = nRhs;
+    std::vector<double> y(size_t(n)*nr);
+    for(int c=0; c<nr; c++)
+        for(int i=0; i<n; i++)
+            y[size_t(i)*nr+c] = b[size_t(c)*n+perm[i]];
+
+    if(isSinglePrecision)
+        solveFactor(lvalues32.data(), y.data(), nr);
+    else
+        solveFactor(lvalues.data(), y.data(), nr);
+
+    for(int c=0; c<nr; c++)
+        for(int i=0; i<n; i++)
+            x[size_t(c)*n+perm[i]] = y[size_t(i)*nr+c];
+}
+
+
+template<typename real>
+void SparseCholesky::solveFactor(const real *lfactor, double *y, int nr) const
+{
+    // the solves accumulate in double whatever the precision of the factor
+
+    // L*Z = Y
+    for(int s=0; s<nSupernodes(); s++)
+    {
+        const int f = super[s], k = super[s+1]-f, m = rowptr[s+1]-rowptr[s];
+        const int *srows = rows.data()+rowptr[s];
+        const real *L = lfactor+lptr[s];
+
+        for(int j=0; j<k; j++)
+        {
+            const real *lj = L+size_t(j)*m;
+            double *yj = y+size_t(f+j)*nr;
+            for(int c=0; c<nr; c++)
+                yj[c] /= lj[j];
+
+            for(int i=j+1; i<m; i++)
+            {
+                double *yi = y+size_t(srows[i])*nr;
+                const double l = lj[i];
+#pragma omp simd
+                for(int c=0; c<nr; c++)
+                    yi[c] -= l*yj[c];
+            }
+        }
+    }
+
+    // Lt*Y = Z
+    for(int s=nSupernodes()-1; s>=0; s--)
+    {
+        const int f = super[s], k = super[s+1]-f, m = rowptr[s+1]-rowptr[s];
+        const int *srows = rows.data()+rowptr[s];
+        const real *L = lfactor+lptr[s];
+
+        for(int j=k-1; j>=0; j--)
+        {
+            const real *lj = L+size_t(j)*m;
+            double *yj = y+size_t(f+j)*nr;
+            for(int i=j+1; i<m; i++)
+            {
+                const double *yi = y+size_t(srows[i])*nr;
+                const double l = lj[i];
+#pragma omp simd
+                for(int c=0; c<nr; c++)
+                    yj[c] -= l*yi[c];
+            }
+            for(int c=0; c<nr; c++)
+                yj[c] /= lj[j];
+        }
+    }
+}
+
+
+int SparseCholesky::nSupernodes(void) const
+{
+    return int(super.size())-1;
+}
+
+
+long long SparseCholesky::nnz(void) const
+{
+    long long count = 0;
+    for(int s=0; s<nSupernodes(); s++)
+    {
+        long long k = super[s+1]-super[s], m = rowptr[s+1]-rowptr[s];
+        count += k*m - k*(k-1)/2;
+    }
+
+    return count;
+}
+
+
+long long SparseCholesky::flops(void) const
+{
+    return work.empty()? 0 : work.back();
+}
@@ -0,0 +1,85 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef SPARSECHOLESKY_H
+#define SPARSECHOLESKY_H
+
+#include "sparsematrix.h"
+
+#include <vector>
+
+///
+/// \brief The SparseCholesky class
+/// Direct solver A = L*Lt for the assembled stiffness. The equations are
+/// reordered by nested dissection of the node graph to reduce the fill,
+/// the symbolic analysis (elimination tree, column counts) groups columns
+/// with the same structure into supernodes, and the numeric factorization
+/// is multifrontal: each supernode is a dense front, factorized with
+/// blocked kernels, whose Schur complement is added to the parent front.
+/// Independent subtrees are factorized in parallel.
+///
+class SparseCholesky
+{
+public:
+    SparseCholesky();
+
+    // the factor is stored in float when set before factorize: half the
+    // memory and bandwidth, the solution must then be refined by the caller
+    bool isSinglePrecision;
+
+    // blockptr: equations of each node; false if a pivot is not positive
+    bool factorize(const SparseMatrix &a, const std::vector<int> &blockptr);
+    void solve(const double *b, double *x, int nRhs = 1) const; // columns of n values
+
+    // ordering and symbolic analysis only, for the size of the factor
+    void analysePattern(const SparseMatrix &a, const std::vector<int> &blockptr);
+
+    int nSupernodes(void) const;
+    long long nnz(void) const;   // entries of L
+    long long flops(void) const; // multiply-adds of the numeric factorization
+    int failedEquation;        // where the factorization broke down, -1 if none
+
+private:
+    int n;
+    std::vector<int> perm; // equation of each row of L
+
+    // supernode s: columns super[s] to super[s+1]-1, rows (global, sorted)
+    // rows[rowptr[s]] to rows[rowptr[s+1]-1]; dense panel column by column
+    std::vector<int> super, rowptr, rows;
+    std::vector<long long> lptr;
+    std::vector<double> lvalues;
+    std::vector<float> lvalues32; // factor in single precision
+
+    std::vector<int> childptr, children; // supernodal elimination tree
+    std::vector<long long> work;         // flops of each subtree
+
+    // lower triangle of the permuted A, column by column
+    std::vector<int> acolptr, arowind;
+    std::vector<double> avalues;
+
+    void order(const SparseMatrix &a, const std::vector<int> &blockptr);
+    void analyse(const SparseMatrix &a);
+
+    // numeric kernels for a factor of double or float values
+    template<typename real>
+    void factorTree(int s, real *lfactor, std::vector< std::vector<real> > &updates, int &failed);
+    template<typename real>
+    bool factorSupernode(int s, real *lfactor, std::vector< std::vector<real> > &updates);
+    template<typename real>
+    void solveFactor(const real *lfactor, double *y, int nRhs) const;
+};
+
+#endif // SPARSECHOLESKY_H
@@ -0,0 +1,211 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "sparsematrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+SparseMatrix::SparseMatrix()
+{
+    n = 0;
+    nnz = 0;
+}
+
+
+void SparseMatrix::setBlockPattern(int nNodes, const int *connectivity, int nElements, int nodesPerElement,
+                                   const int *equation)
+{
+    // nodal graph: node i is coupled with node j if they share an element
+    std::vector< std::vector<int> > adjacency(nNodes);
+
+    for(int iel=0; iel<nElements; iel++)
+    {
+        const int *enodes = connectivity + iel*nodesPerElement;
+        for(int i=0; i<nodesPerElement; i++)
+            for(int j=0; j<nodesPerElement; j++)
+                adjacency[enodes[i]].push_back(enodes[j]);
+    }
+
+    for(int i=0; i<nNodes; i++)
+    {
+        std::sort(adjacency[i].begin(), adjacency[i].end());
+        adjacency[i].erase(std::unique(adjacency[i].begin(), adjacency[i].end()), adjacency[i].end());
+    }
+
+    // dof -> row, identity unless a reduced numbering is given
+    std::vector<int> identity;
+    if(equation == nullptr)
+    {
+        identity.resize(3*nNodes);
+        for(int t=0; t<3*nNodes; t++)
+            identity[t] = t;
+        equation = identity.data();
+    }
+
+    // expand each node pair into a 3x3 block of the kept dofs
+    n = 0;
+    for(int t=0; t<3*nNodes; t++)
+        if(equation[t] >= 0)
+            n++;
+
+    rowptr.assign(n+1, 0);
+
+    for(int i=0; i<nNodes; i++)
+    {
+        int count = 0;
+        for(size_t t=0; t<adjacency[i].size(); t++)
+            for(int jj=0; jj<3; jj++)
+                if(equation[3*adjacency[i][t]+jj] >= 0)
+                    count++;
+
+        for(int ii=0; ii<3; ii++)
+            if(equation[3*i+ii] >= 0)
+                rowptr[equation[3*i+ii]+1] = count;
+    }
+
+    for(int i=0; i<n; i++)
+        rowptr[i+1] += rowptr[i];
+
+    nnz = rowptr[n];
+    colind.resize(nnz);
+
+    for(int i=0; i<nNodes; i++)
+        for(int ii=0; ii<3; ii++)
+        {
+            if(equation[3*i+ii] < 0)
+                continue;
+
+            int p = rowptr[equation[3*i+ii]];
+            for(size_t t=0; t<adjacency[i].size(); t++)
+                for(int jj=0; jj<3; jj++)
+                    if(equation[3*adjacency[i][t]+jj] >= 0)
+                        colind[p++] = equation[3*adjacency[i][t]+jj];
+        }
+
+    // a renumbered equation order does not follow the node order
+    for(int i=0; i<n; i++)
+        std::sort(colind.begin()+rowptr[i], colind.begin()+rowptr[i+1]);
+
+    values.assign(nnz, 0.0);
+}
+
+
+int SparseMatrix::find(int i, int j) const
+{
+    const int *begin = colind.data() + rowptr[i];
+    const int *end = colind.data() + rowptr[i+1];
+    const int *p = std::lower_bound(begin, end, j);
+
+    if(p == end || *p != j)
+        return -1;
+
+    return int(p - colind.data());
+}
+
+
+void SparseMatrix::add(int i, int j, double value)
+{
+    values[find(i, j)] += value;
+}
+
+
+double SparseMatrix::operator()(int i, int j) const
+{
+    int p = find(i, j);
+    return p<0? 0.0 : values[p];
+}
+
+
+void SparseMatrix::zero(void)
+{
+    std::fill(values.begin(), values.end(), 0.0);
+}
+
+
+void SparseMatrix::multiply(const double *x, double *y) const
+{
+#pragma omp parallel for schedule(static)
+    for(int i=0; i<n; i++)
+    {
+        double sum = 0.0;
+        for(int p=rowptr[i]; p<rowptr[i+1]; p++)
+            sum += values[p]*x[colind[p]];
+        y[i] = sum;
+    }
+}
+
+
+int SparseMatrix::size(void) const
+{
+    return n;
+}
+
+
+void SparseMatrix::diagonal(double *d) const
+{
+    for(int i=0; i<n; i++)
+        d[i] = (*this)(i, i);
+}
+
+
+void SparseMatrix::diagonalBlocks(const int *blockptr, int nBlocks, double *blocks) const
+{
+    for(int k=0; k<nBlocks; k++)
+        for(int i=blockptr[k]; i<blockptr[k+1]; i++)
+            for(int j=blockptr[k]; j<blockptr[k+1]; j++)
+                blocks[9*k+3*(i-blockptr[k])+j-blockptr[k]] = (*this)(i, j);
+}
+
+
+double SparseMatrix::memory(void) const
+{
+    return (double(nnz)*(sizeof(double)+sizeof(int)) + double(n+1)*sizeof(int))/(1024.*1024.);
+}
+
+
+unsigned long long SparseMatrix::hash(void) const
+{
+    // FNV-1a over 64 bit words: rows, columns and the bits of the values
+    const unsigned long long prime = 1099511628211ULL;
+    unsigned long long h = 14695981039346656037ULL;
+
+    h = (h ^ (unsigned long long)(n)) * prime;
+    for(size_t i=0; i<rowptr.size(); i++)
+        h = (h ^ (unsigned long long)(rowptr[i])) * prime;
+    for(size_t p=0; p<colind.size(); p++)
+        h = (h ^ (unsigned long long)(colind[p])) * prime;
+    for(size_t p=0; p<values.size(); p++)
+    {
+        unsigned long long bits;
+        std::memcpy(&bits, &values[p], sizeof(bits));
+        h = (h ^ bits) * prime;
+    }
+
+    return h;
+}
+
+
+void SparseMatrix::toDense(Mth::Matrix &a) const
+{
+    a.resize(n, n);
+    a = 0.0;
+
+    for(int i=0; i<n; i++)
+        for(int p=rowptr[i]; p<rowptr[i+1]; p++)
+            a(i, colind[p]) = values[p];
+}
@@ -0,0 +1,65 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef SPARSEMATRIX_H
+#define SPARSEMATRIX_H
+
+#include <vector>
+
+#include "linearoperator.h"
+
+#include <mth/matrix.h>
+
+///
+/// \brief The SparseMatrix class
+/// Square matrix in compressed sparse row (CSR) format. The pattern is built
+/// from the nodal connectivity of the mesh, with 3x3 blocks per node pair
+/// (3 dof per node), and the column indices of each row are kept sorted.
+/// With an equation map the restricted dofs are left out of the pattern.
+///
+class SparseMatrix : public LinearOperator
+{
+public:
+    int n;   // number of rows (and columns)
+    int nnz; // number of stored entries
+
+    std::vector<int> rowptr;
+    std::vector<int> colind;
+    std::vector<double> values;
+
+    SparseMatrix();
+
+    // connectivity: nElements x nodesPerElement node indices, row by row
+    // equation: row of each dof (increasing), -1 drops the dof
+    void setBlockPattern(int nNodes, const int *connectivity, int nElements, int nodesPerElement,
+                         const int *equation = nullptr);
+
+    int find(int i, int j) const;
+    void add(int i, int j, double value);
+    double operator()(int i, int j) const;
+
+    int size(void) const;
+    void diagonal(double *d) const;
+    void diagonalBlocks(const int *blockptr, int nBlocks, double *blocks) const;
+    void multiply(const double *x, double *y) const;
+    void zero(void);
+
+    double memory(void) const; // MB
+    unsigned long long hash(void) const; // of the pattern and the values
+    void toDense(Mth::Matrix &a) const;
+};
+
+#endif // SPARSEMATRIX_H
@@ -0,0 +1,144 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "tetrabatch.h"
+
+TetraBatch::TetraBatch()
+{
+    count = 0;
+}
+
+
+void TetraBatch::gather(Solid3DElement **elements, const int *ids, int count,
+                        const double *coordinates, const int *connectivity)
+{
+    this->count = count;
+
+    // unused lanes repeat the last element so they stay well conditioned
+    for(int l=0; l<width; l++)
+    {
+        int e = l<count? l : count-1;
+        this->ids[l] = ids[e];
+        this->elements[l] = elements[ids[e]];
+
+        // coordinates from the flat mesh arrays (SolidMesh)
+        Solid3DElement *element = this->elements[l];
+        const int *enodes = connectivity + T::nNodes*size_t(ids[e]);
+        for(int i=0; i<T::nNodes; i++)
+        {
+            x[i][l] = coordinates[3*size_t(enodes[i])+0];
+            y[i][l] = coordinates[3*size_t(enodes[i])+1];
+            z[i][l] = coordinates[3*size_t(enodes[i])+2];
+        }
+
+        for(int i=0; i<T::nStress; i++)
+            for(int j=0; j<T::nStress; j++)
+                D[i][j][l] = element->material->D(i,j);
+    }
+}
+
+
+TETRA_BATCH_CLONES
+void TetraBatch::evalStiffnessMatrices(void)
+{
+    // volumes
+#pragma omp simd
+    for(int l=0; l<width; l++)
+        V[l] = ((x[1][l]-x[0][l])*(y[2][l]-y[0][l])*(z[3][l]-z[0][l])
+              + (x[2][l]-x[0][l])*(y[3][l]-y[0][l])*(z[1][l]-z[0][l])
+              + (x[3][l]-x[0][l])*(y[1][l]-y[0][l])*(z[2][l]-z[0][l])
+              - (x[3][l]-x[0][l])*(y[2][l]-y[0][l])*(z[1][l]-z[0][l])
+              - (x[2][l]-x[0][l])*(y[1][l]-y[0][l])*(z[3][l]-z[0][l])
+              - (x[1][l]-x[0][l])*(y[3][l]-y[0][l])*(z[2][l]-z[0][l]))/6.0;
+
+    // shape function derivatives, same cyclic node numbering as
+    // Solid3DElement::evalShapeDerivatives (odd nodes change sign)
+    for(int i=0; i<T::nNodes; i++)
+    {
+        const int i1 = (i+1)%4, i2 = (i+2)%4, i3 = (i+3)%4;
+        const double sign = i%2? -1.0 : 1.0;
+
+#pragma omp simd
+        for(int l=0; l<width; l++)
+        {
+            double factor = sign/(6.0*V[l]);
+
+            b[i][l] = factor*(-(y[i2][l]*z[i3][l]+y[i1][l]*z[i2][l]+y[i3][l]*z[i1][l])
+                              +(y[i2][l]*z[i1][l]+y[i1][l]*z[i3][l]+y[i3][l]*z[i2][l]));
+            c[i][l] = factor*(-(x[i1][l]*z[i3][l]+x[i2][l]*z[i1][l]+x[i3][l]*z[i2][l])
+                              +(x[i3][l]*z[i1][l]+x[i2][l]*z[i3][l]+x[i1][l]*z[i2][l]));
+            d[i][l] = factor*(-(x[i1][l]*y[i2][l]+x[i2][l]*y[i3][l]+x[i3][l]*y[i1][l])
+                              +(x[i3][l]*y[i2][l]+x[i2][l]*y[i1][l]+x[i1][l]*y[i3][l]));
+        }
+    }
+
+    // DB = D*B (6x12), skipping the zeros of B (Solid3DElement::evalDB)
+    alignas(64) double DB[T::nStress][T::nDofs][width];
+
+    for(int i=0; i<T::nNodes; i++)
+        for(int s=0; s<T::nStress; s++)
+        {
+#pragma omp simd
+            for(int l=0; l<width; l++)
+                Solid3DElement::evalDB<width>(&D[s][0][l], b[i][l], c[i][l], d[i][l], &DB[s][3*i][l]);
+        }
+
+    // upper blocks of V*Bt*DB, lower blocks by symmetry
+    for(int i=0; i<T::nNodes; i++)
+        for(int j=3*i; j<T::nDofs; j++)
+        {
+#pragma omp simd
+            for(int l=0; l<width; l++)
+            {
+                ke[(3*i+0)*T::nDofs+j][l] = V[l]*(b[i][l]*DB[0][j][l] + c[i][l]*DB[3][j][l] + d[i][l]*DB[5][j][l]);
+                ke[(3*i+1)*T::nDofs+j][l] = V[l]*(c[i][l]*DB[1][j][l] + b[i][l]*DB[3][j][l] + d[i][l]*DB[4][j][l]);
+                ke[(3*i+2)*T::nDofs+j][l] = V[l]*(d[i][l]*DB[2][j][l] + c[i][l]*DB[4][j][l] + b[i][l]*DB[5][j][l]);
+            }
+        }
+
+    for(int i=0; i<T::nDofs; i++)
+        for(int j=0; j<3*(i/3); j++)
+        {
+#pragma omp simd
+            for(int l=0; l<width; l++)
+                ke[i*T::nDofs+j][l] = ke[j*T::nDofs+i][l];
+        }
+
+    // the stress recovery uses the element coefficients
+    for(int l=0; l<count; l++)
+    {
+        Solid3DElement *element = elements[l];
+        element->V = V[l];
+        for(int i=0; i<T::nNodes; i++)
+        {
+            element->b[i] = b[i][l];
+            element->c[i] = c[i][l];
+            element->d[i] = d[i][l];
+        }
+    }
+}
+
+
+void TetraBatch::scatter(double *values, const int *scatter) const
+{
+    for(int l=0; l<count; l++)
+    {
+        const int *map = scatter + T::nKe*size_t(ids[l]);
+        for(int t=0; t<T::nKe; t++)
+            if(map[t] >= 0)
+                values[map[t]] += ke[t][l];
+    }
+}
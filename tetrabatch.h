@@ -0,0 +1,70 @@
+/****************************************************************************
+** Copyright (C) 2017 Ivan Assing da Silva
+** Contact: ivanassing@gmail.com
+**
+** This file is part of the FEA_MNE772 project.
+**
+** This file is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 3 of the License, or
+** (at your option) any later version.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef TETRABATCH_H
+#define TETRABATCH_H
+
+#include "solid3delement.h"
+#include "elementtraits.h"
+
+// number of elements per pack: one AVX-512 or two AVX2 registers of doubles
+#define TETRA_BATCH_WIDTH 8
+
+// the pack kernel is compiled for each instruction set and the one of the
+// running CPU is chosen at load time, without -march=native
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define TETRA_BATCH_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define TETRA_BATCH_CLONES
+#endif
+
+///
+/// \brief The TetraBatch class
+/// Pack of Solid3DElements stored as structure of arrays, one element per
+/// SIMD lane. Volumes, B coefficients and ke = V*Bt*D*B are evaluated for
+/// the whole pack at once; every loop over lanes is vectorized, for AVX-512,
+/// AVX2 or SSE2 depending on the CPU (TETRA_BATCH_CLONES).
+///
+class TetraBatch
+{
+public:
+    typedef ElementTraits<Solid3DElement> T;
+    enum { width = TETRA_BATCH_WIDTH };
+
+    int count; // lanes in use
+    int ids[width];
+    Solid3DElement *elements[width];
+
+    alignas(64) double x[T::nNodes][width];
+    alignas(64) double y[T::nNodes][width];
+    alignas(64) double z[T::nNodes][width];
+    alignas(64) double D[T::nStress][T::nStress][width];
+
+    alignas(64) double V[width];
+    alignas(64) double b[T::nNodes][width];
+    alignas(64) double c[T::nNodes][width];
+    alignas(64) double d[T::nNodes][width];
+    alignas(64) double ke[T::nKe][width];
+
+    TetraBatch();
+
+    void gather(Solid3DElement **elements, const int *ids, int count,
+                const double *coordinates, const int *connectivity);
+    void evalStiffnessMatrices(void);
+    void scatter(double *values, const int *scatter) const;
+};
+
+#endif // TETRABATCH_H
@@ -190,13 +190,24 @@ isIterativeSolver = true;
 
 void Truss3D::evalStiffnessMatrix(void)
 {
-    k.resize(3*nNodes, 3*nNodes);
-    k = 0.0;
+    // sparsity pattern from the edge list (node1, node2) of the bars
+    std::vector<int> connectivity(2*nElements);
+    for(int i=0; i<nElements; i++)
+    {
+        connectivity[2*i] = elements[i]->node1->index;
+        connectivity[2*i+1] = elements[i]->node2->index;
+    }
+
+    if(int(dofs.nodeOrder.size()) != nNodes)
+        dofs.renumber(nNodes, connectivity.data(), nElements, 2);
+    dofs.setNodes(nodes, nNodes);
+    k.setBlockPattern(nNodes, connectivity.data(), nElements, 2, dofs.equation.data());
 
     f.resize(3*nNodes);
     f = 0.0;
 
-    Mth::Matrix ke(6,6);
+    typedef ElementTraits<Truss3DElement> T;
+    double ke[T::nKe];
 
     Node3D **ptrNodes = new Node3D*[2];
 
@@ -217,9 +228,11 @@ void Truss3D::evalStiffnessMatrix(void)
                 for(int ii=0;ii<3;ii++)
                     for(int ij=0;ij<3;ij++)
                     {
-                        int indexI = 3*ptrNodes[ni]->index+ii;
-                        int indexJ = 3*ptrNodes[nj]->index+ij;
-                        k(indexI, indexJ) += ke(3*ni+ii, 3*nj+ij);
+                        // restricted dofs are eliminated from k
+                        int indexI = dofs.equation[3*ptrNodes[ni]->index+ii];
+                        int indexJ = dofs.equation[3*ptrNodes[nj]->index+ij];
+                        if(indexI>=0 && indexJ>=0)
+                            k.add(indexI, indexJ, ke[(3*ni+ii)*T::nDofs+3*nj+ij]);
                     }
 
     }
@@ -233,109 +246,128 @@ void Truss3D::evalStiffnessMatrix(void)
 
     delete [] ptrNodes;
 
+    MsgLog::information(QString("Sparse stiffness matrix: %1 free dof (%2 restricted), %3 nonzeros (%4 MB)")
+                        .arg(k.n).arg(dofs.nDofs-dofs.nFree).arg(k.nnz).arg(k.memory()));
 }
 
 
-void Truss3D::solve(void)
+void Truss3D::liftPrescribedValues(std::vector<double> &fr)
 {
-    //std::ofstream flog("log_solver.txt");
+    if(!dofs.hasPrescribedValues())
+        return;
 
-    Mth::Matrix kc(k); // cópias
-    Mth::Vector fc(f);
+    // fr -= k(free, restricted)*prescribed, element by element
+    typedef ElementTraits<Truss3DElement> T;
+    double ke[T::nKe];
 
-    // Aplica as condicoes de contorno
-    for(int i=0; i<nNodes; i++)
+    for(int i=0; i<nElements; i++)
+    {
+        int dof[6];
         for(int j=0; j<3; j++)
-            if(nodes[i]->restrictions[j]==true)
-            {
-                //flog<<"\n"<<i<<" "<<nodes[i]->restrictions[j];
-                int n = 3*nodes[i]->index+j;
-                for(int t=0; t<3*nNodes; t++)
-                    kc(n, t) = kc(t, n) = 0.0;
-                kc(n, n) = 1.0;
-                fc(n) = nodes[i]->displacements[j];
-            }
-
-//    for(int i=0; i<3*nNodes; i++)
-//    {
-//        bool check = true;
-//        for(int j=0; j<3*nNodes; j++)
-//            if(fabs(kc(i, j))>1.e-10) {check = false ; break;}
-//        if(check)
-//        {
-//            int t = i/3;
-//            int v = i-3*t;
-//            flog<<"\n error in line: "<<i<<" node: "<<t<<" v: "<<v;
-//            //            for(int t=0; t<3*nNodes; t++)
-//            //                kc(i, t) = kc(t, i) = 0.0;
-//            //            kc(i, i) = 1.0;
-//            //            fc(i) = 0.0;
-
-//        }
-//    }
+        {
+            dof[j] = 3*elements[i]->node1->index+j;
+            dof[3+j] = 3*elements[i]->node2->index+j;
+        }
 
-//    for(int i=0; i<3*nNodes; i++)
-//    {
-//        bool check = true;
-//        for(int j=0; j<3*nNodes; j++)
-//            if(fabs(kc(j, i))>1.e-10) {check = false ; break;}
-//        if(check) flog<<"\n error in column: "<<i;
-//    }
+        bool isLifted = false;
+        for(int j=0; j<6; j++)
+            if(dofs.equation[dof[j]]<0 && dofs.prescribed[dof[j]]!=0.0)
+                isLifted = true;
 
+        if(!isLifted)
+            continue;
 
+        elements[i]->getStiffnessMatrix(ke);
 
+        for(int r=0; r<6; r++)
+            if(dofs.equation[dof[r]] >= 0)
+                for(int c=0; c<6; c++)
+                    if(dofs.equation[dof[c]] < 0)
+                        fr[dofs.equation[dof[r]]] -= ke[r*T::nDofs+c]*dofs.prescribed[dof[c]];
+    }
+}
 
-    //    std::cerr<<"\n\n Matriz de rigidez\n";
-    //    std::cerr<<kc;
 
-    //    std::cerr<<"\n\n Vetor de carga\n";
-    //    std::cerr<<fc;
+void Truss3D::evalReactions(const std::vector<double> &x, std::vector<double> &r)
+{
+    // r = k*x with the full element matrices, restricted dofs included
+    typedef ElementTraits<Truss3DElement> T;
+    double ke[T::nKe];
+    r.assign(3*nNodes, 0.0);
 
-    //    Mth::Matrix kcc(kc);
-    //    Mth::Vector fcc(fc);
+    for(int i=0; i<nElements; i++)
+    {
+        int dof[6];
+        for(int j=0; j<3; j++)
+        {
+            dof[j] = 3*elements[i]->node1->index+j;
+            dof[3+j] = 3*elements[i]->node2->index+j;
+        }
 
-    //    std::cerr<<"\n\n Teste\n";
-    //    kcc.inverse();
-    //    std::cerr<<kcc*fcc;
+        elements[i]->getStiffnessMatrix(ke);
+
+        for(int a=0; a<6; a++)
+            for(int b=0; b<6; b++)
+                r[dof[a]] += ke[a*T::nDofs+b]*x[dof[b]];
+    }
+}
+
+
+void Truss3D::solveConstrainedSystem(const std::vector<double> &fc, std::vector<double> &x)
+{
+    // reduced system of the free dofs, prescribed displacements lifted
+    std::vector<double> fr(dofs.nFree), xr;
+    dofs.restrict(fc.data(), fr.data());
+    liftPrescribedValues(fr);
+
+    solver.solve(k, dofs, fr, xr, isIterativeSolver);
+
+    x.resize(dofs.nDofs);
+    dofs.expand(xr.data(), x.data());
+}
+
+
+void Truss3D::solve(void)
+{
+    //std::ofstream flog("log_solver.txt");
+
+    std::vector<double> fc(3*nNodes);
+    for(int i=0; i<3*nNodes; i++)
+        fc[i] = f(i);
 
     // Aloca vetor para resultados
     u.resize(3*nNodes);
 
-    if(isIterativeSolver)
-    {
-        MsgLog::information(QString("Iterative solver, spare matrix on GPU"));
-        QString log;
-        kc.solve_sparse(fc, u, log); // solve sparse on GPU
-        QStringList list;
-        list = log.split("\n");
-        for(int i=0; i<list.size();i++)
-        MsgLog::information(list[i]);
-    }
-    else
-    {
-        MsgLog::information(QString("Direct solver, dense matrix on CPU"));
-        QString log;
-        kc.solve_symmetric(fc, u, log); // solve dense on CPU
-        MsgLog::information(log);
-    }
+    // Resolve o sistema reduzido (condicoes de contorno)
+    std::vector<double> x;
+    solveConstrainedSystem(fc, x);
 
+    for(int i=0; i<3*nNodes; i++)
+        u(i) = x[i];
 
-    //u.clear();
+    evalResults();
+}
 
-    //flog<<"\n\n Solução\n";
-    //flog<<u;
 
+void Truss3D::evalResults(void)
+{
+    std::vector<double> x(3*nNodes);
+    for(int i=0; i<3*nNodes; i++)
+        x[i] = u(i);
 
-    //    std::cerr<<"\n\n Matriz de rigidez\n";
-    //    std::cerr<<k;
-    //reactions.resize(3*nNodes);
+    // reacoes
+    std::vector<double> r;
+    evalReactions(x, r);
 
-    //reactions = k*u;
+    reactions.resize(3*nNodes);
+    for(int i=0; i<3*nNodes; i++)
+        reactions(i) = r[i];
 
-    //reactions.clear(1.e-10);
 
-    //flog<<"\n\n Reações\n";
-    //flog<<reactions;
+    //u.clear();
+
+    //flog<<"\n\n Solução\n";
+    //flog<<u;
 
 
     Mth::Matrix ue(6);
@@ -369,112 +401,46 @@ void Truss3D::solve(void)
 }
 
 
-
 void Truss3D::solve_simulation(int steps)
 {
     nSteps = steps;
 
-    f_simulation.resize(3*nNodes, nSteps);
-    f_simulation = 0.0;
-
-    double delta = 1.0/nSteps;
-    double factor;
-
-
-    for(int k=0; k<nSteps; k++)
-    {
-        factor = k*delta;
-        for(int i=0; i<nNodes; i++)
-        {
-            f_simulation(3*nodes[i]->index, k) = factor *nodes[i]->loading[0];
-            f_simulation(3*nodes[i]->index+1, k) = factor * nodes[i]->loading[1];
-            f_simulation(3*nodes[i]->index+2, k) = factor * nodes[i]->loading[2];
-        }
-    }
-
-
-//    std::ofstream flog("log_simulation.txt");
-
-//    flog<<f_simulation;
-
-//    flog.close();
-
-
-
-    Mth::Matrix kc(k); // cópias
-    Mth::Matrix fc(f_simulation);
-
-    // Aplica as condicoes de contorno
-
+    std::vector<double> fcc(3*nNodes, 0.0);
     for(int i=0; i<nNodes; i++)
-        for(int j=0; j<3; j++)
-            if(nodes[i]->restrictions[j]==true)
-            {
-                int n = 3*nodes[i]->index+j;
-                for(int t=0; t<3*nNodes; t++)
-                    kc(n, t) = kc(t, n) = 0.0;
-                kc(n, n) = 1.0;
-                for(int k=0; k<nSteps; k++)
-                    fc(n,k) = nodes[i]->displacements[j];
-            }
-
-    u_simulation.resize(3*nNodes, nSteps);
-
-    //kc.solve(fc, u_simulation);
-    //kc.solve_symmetric(fc, u_simulation);
-
-    /////////////////////////////
-    Mth::Matrix fcc(3*nNodes);
-    Mth::Matrix ucc(3*nNodes);
-    for(int i=0; i<3*nNodes; i++)
     {
-        fcc(i) = f_simulation(i,nSteps-1);
+        fcc[3*nodes[i]->index] = nodes[i]->loading[0];
+        fcc[3*nodes[i]->index+1] = nodes[i]->loading[1];
+        fcc[3*nodes[i]->index+2] = nodes[i]->loading[2];
     }
-    kc.solve_symmetric(fcc, ucc);
 
-    for(int k=0; k<nSteps; k++)
-    {
-        factor = k*delta;
-        for(int i=0; i<3*nNodes; i++)
-            u_simulation(i,k) = ucc(i)*factor;
-    }
-    /////////////////////////////
-
-
-
-
-    //u_simulation.clear();
-
-    reactions_simulation.resize(3*nNodes, nSteps);
+    // Resolve o sistema reduzido (condicoes de contorno)
+    std::vector<double> ucc;
+    solveConstrainedSystem(fcc, ucc);
 
-    reactions_simulation = k*u_simulation;
-
-    //reactions_simulation.clear(1.e-10);
-
-
-    Mth::Matrix ue(6);
+    // problema linear: deslocamentos, reacoes e tensoes escalam com o fator
+    // de carga, so os resultados da carga total sao guardados
+    u.resize(3*nNodes);
+    for(int i=0; i<3*nNodes; i++)
+        u(i) = ucc[i];
 
-    stress_simulation.resize(nElements, nSteps);
+    evalResults();
 
+    std::vector<double> rcc(3*nNodes), scc(nElements);
+    for(int i=0; i<3*nNodes; i++)
+        rcc[i] = reactions(i);
     for(int i=0; i<nElements; i++)
-        for(int k=0; k<nSteps; k++)
-        {
-            ue(0) = u_simulation(3*elements[i]->node1->index, k);
-            ue(1) = u_simulation(3*elements[i]->node1->index+1, k);
-            ue(2) = u_simulation(3*elements[i]->node1->index+2, k);
-            ue(3) = u_simulation(3*elements[i]->node2->index, k);
-            ue(4) = u_simulation(3*elements[i]->node2->index+1, k);
-            ue(5) = u_simulation(3*elements[i]->node2->index+2, k);
-
-            stress_simulation(i, k) = elements[i]->getStress(ue);
-        }
+        scc[i] = stress(i);
 
-    isSolved_simulation = true;
+    f_simulation.setSteps(nSteps);
+    f_simulation.setField(fcc);
+    u_simulation.setSteps(nSteps);
+    u_simulation.setField(ucc);
+    reactions_simulation.setSteps(nSteps);
+    reactions_simulation.setField(rcc);
+    stress_simulation.setSteps(nSteps);
+    stress_simulation.setField(scc);
 
-
-    u.resize(3*nNodes);
-    reactions.resize(3*nNodes);
-    stress.resize(nElements);
+    isSolved_simulation = true;
 
 
     for(int i=0; i<3*nNodes; i++)
@@ -510,17 +476,7 @@ void Truss3D::stresslimits(double &min, double &max)
 
 void Truss3D::stresslimits_simulation(double &min, double &max)
 {
-    min = stress_simulation(0,0);
-    max = stress_simulation(0,0);
-
-    for(int k=0; k<stress_simulation.n; k++)
-        for(int i=1; i<stress_simulation.m; i++)
-        {
-            double value = stress_simulation(i,k);
-            if(value>max) max = value;
-            if(value<min) min = value;
-        }
-
+    stress_simulation.limits(0, min, max);
 }
 
 
@@ -21,6 +21,10 @@
 #include "truss3delement.h"
 
 #include "dxfreader.h"
+#include "sparsematrix.h"
+#include "dofmap.h"
+#include "linearsolver.h"
+#include "rampresult.h"
 
 #include <mth/matrix.h>
 #include <mth/vector.h>
@@ -37,6 +41,13 @@ class Truss3D
 private:
     int ndi, nlo, nre, nma;
 
+    DofMap dofs;
+
+    void liftPrescribedValues(std::vector<double> &fr);
+    void solveConstrainedSystem(const std::vector<double> &fc, std::vector<double> &x);
+    void evalReactions(const std::vector<double> &x, std::vector<double> &r);
+    void evalResults(void); // reactions and stresses from u
+
 public:
     Node3D **nodes;
     Truss3DElement **elements;
@@ -50,7 +61,7 @@ public:
     int nElements;
     bool isMounted,isSolved;
 
-    Mth::Matrix k;
+    SparseMatrix k; // free dofs only
     Mth::Vector f;
     Mth::Vector u;
 
@@ -71,18 +82,20 @@ public:
 
     void solve(void);
 
-    // variables for ramp computation
+    // variables for ramp computation: steps evaluated on access
     int nSteps;
-    Mth::Matrix f_simulation;
-    Mth::Matrix u_simulation;
+    RampResult f_simulation;
+    RampResult u_simulation;
 
-    Mth::Matrix reactions_simulation;
-    Mth::Matrix stress_simulation;
+    RampResult reactions_simulation;
+    RampResult stress_simulation;
 
     void solve_simulation(int nSteps);
     void stresslimits_simulation(double &min, double &max);
     bool isSolved_simulation;
+
     bool isIterativeSolver;
+    LinearSolver solver; // direct method, tolerance, iterations and preconditioner
 
     virtual ~Truss3D();
 };
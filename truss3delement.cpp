@@ -51,8 +51,11 @@ Truss3DElement::Truss3DElement(int index, Truss3DElement *element)
 }
 
 
-void Truss3DElement::getStiffnessMatrix(Mth::Matrix &ke)
+void Truss3DElement::getStiffnessMatrix(double *ke)
 {
+    // ke (6x6, row by row) in a caller array, as Solid3DElement
+    typedef ElementTraits<Truss3DElement> T;
+
     double c[3];
 
 
@@ -66,10 +69,11 @@ void Truss3DElement::getStiffnessMatrix(Mth::Matrix &ke)
     for(int i=0; i<3; i++)
         for(int j=0; j<3; j++)
         {
-            ke(i,j) = material->E*material->A*c[i]*c[j]*inv_l*inv_l*inv_l;
-            ke(i+3, j+3) = ke(i,j);
-            ke(i+3,j) = -ke(i,j);
-            ke(i, j+3) = -ke(i,j);
+            double kij = material->E*material->A*c[i]*c[j]*inv_l*inv_l*inv_l;
+            ke[i*T::nDofs+j] = kij;
+            ke[(i+3)*T::nDofs+j+3] = kij;
+            ke[(i+3)*T::nDofs+j] = -kij;
+            ke[i*T::nDofs+j+3] = -kij;
         }
 }
 
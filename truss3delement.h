@@ -19,6 +19,7 @@
 
 #include "node3d.h"
 #include "material.h"
+#include "elementtraits.h"
 #include <mth/matrix.h>
 
 ///
@@ -37,7 +38,7 @@ public:
     Truss3DElement(int index, Truss3DElement *element);
     Truss3DElement(int index, Node3D *node1, Node3D *node2, Material *material);
     double getStress(Mth::Matrix &ue);
-    void getStiffnessMatrix(Mth::Matrix &ke);
+    void getStiffnessMatrix(double *ke);
     void draw(void);
 
 };
@@ -67,7 +67,7 @@ void Truss3DReader::readXML()
     while (xml.readNextStartElement()) {
         if(xml.name() == "mesh")
         {
-            delete mesh;
+            Truss3D *previous = mesh;
             mesh = new Truss3D;
 
             while (xml.readNextStartElement())
@@ -96,6 +96,13 @@ void Truss3DReader::readXML()
             }
 
             mesh->isMounted = true;
+
+            // the factorization is reused if only the loads changed
+            if(previous)
+            {
+                mesh->solver.adoptFactorization(previous->solver);
+                delete previous;
+            }
         }
     }
 }
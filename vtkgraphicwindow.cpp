@@ -71,6 +71,7 @@
 #include <QElapsedTimer>
 
 #include "msglog.h"
+#include "principalstress.h"
 
 
 const char strResults[14][50] = {
@@ -375,9 +376,9 @@ void vtkGraphicWindow::addDataSet(/*Solid3D *mesh*/ void)
 
     for(int i=0; i<s3d_mesh->nNodes; i++)
         points->InsertNextPoint(
-                    s3d_mesh->nodes[i]->coordinates[0],
-                s3d_mesh->nodes[i]->coordinates[1],
-                s3d_mesh->nodes[i]->coordinates[2]);
+                    s3d_mesh->storage.coordinates[3*i],
+                s3d_mesh->storage.coordinates[3*i+1],
+                s3d_mesh->storage.coordinates[3*i+2]);
 
     dataSet_0 = vtkSmartPointer<vtkUnstructuredGrid>::New();
     dataSet_0->SetPoints(points);
@@ -386,10 +387,10 @@ void vtkGraphicWindow::addDataSet(/*Solid3D *mesh*/ void)
 
     for(int i=0; i<s3d_mesh->nElements; i++)
     {
-        vtkIdType ptIds[] = {s3d_mesh->elements[i]->nodes[0]->index,
-                             s3d_mesh->elements[i]->nodes[1]->index,
-                             s3d_mesh->elements[i]->nodes[2]->index,
-                             s3d_mesh->elements[i]->nodes[3]->index};
+        vtkIdType ptIds[] = {s3d_mesh->storage.connectivity[4*i],
+                             s3d_mesh->storage.connectivity[4*i+1],
+                             s3d_mesh->storage.connectivity[4*i+2],
+                             s3d_mesh->storage.connectivity[4*i+3]};
 
         dataSet_0->InsertNextCell( VTK_TETRA, 4, ptIds );
 
@@ -443,6 +444,8 @@ void vtkGraphicWindow::addDataSet_solved(/*Solid3D *mesh*/ void)
         return;
     }
 
+    s3d_mesh->evalResult(s3d_result);
+
     removeDataSet();
 
     vtkSmartPointer< vtkPoints > points =
@@ -450,19 +453,19 @@ void vtkGraphicWindow::addDataSet_solved(/*Solid3D *mesh*/ void)
 
     for(int i=0; i<s3d_mesh->nNodes; i++)
         points->InsertNextPoint(
-                    s3d_mesh->nodes[i]->coordinates[0]+amplification*s3d_mesh->u(3*i),
-                s3d_mesh->nodes[i]->coordinates[1]+amplification*s3d_mesh->u(3*i+1),
-                s3d_mesh->nodes[i]->coordinates[2]+amplification*s3d_mesh->u(3*i+2));
+                    s3d_mesh->storage.coordinates[3*i]+amplification*s3d_mesh->u(3*i),
+                s3d_mesh->storage.coordinates[3*i+1]+amplification*s3d_mesh->u(3*i+1),
+                s3d_mesh->storage.coordinates[3*i+2]+amplification*s3d_mesh->u(3*i+2));
 
     dataSet_1 = vtkSmartPointer<vtkUnstructuredGrid>::New();
     dataSet_1->SetPoints(points);
 
     for(int i=0; i<s3d_mesh->nElements; i++)
     {
-        vtkIdType ptIds[] = {s3d_mesh->elements[i]->nodes[0]->index,
-                             s3d_mesh->elements[i]->nodes[1]->index,
-                             s3d_mesh->elements[i]->nodes[2]->index,
-                             s3d_mesh->elements[i]->nodes[3]->index};
+        vtkIdType ptIds[] = {s3d_mesh->storage.connectivity[4*i],
+                             s3d_mesh->storage.connectivity[4*i+1],
+                             s3d_mesh->storage.connectivity[4*i+2],
+                             s3d_mesh->storage.connectivity[4*i+3]};
 
         dataSet_1->InsertNextCell( VTK_TETRA, 4, ptIds );
     }
@@ -529,6 +532,8 @@ void vtkGraphicWindow::addDataSet_simulation(/*Solid3D *mesh*/ void)
         return;
     }
 
+    s3d_mesh->evalResult(s3d_result);
+
     removeDataSet();
 
     simulation_actors = new vtkSmartPointer<vtkActor>[nSteps];
@@ -551,9 +556,9 @@ void vtkGraphicWindow::addDataSet_simulation(/*Solid3D *mesh*/ void)
 
         for(int i=0; i<s3d_mesh->nNodes; i++)
             points->InsertNextPoint(
-                        s3d_mesh->nodes[i]->coordinates[0]+amplification*s3d_mesh->u(3*i)*t/double(nSteps),
-                    s3d_mesh->nodes[i]->coordinates[1]+amplification*s3d_mesh->u(3*i+1)*t/double(nSteps),
-                    s3d_mesh->nodes[i]->coordinates[2]+amplification*s3d_mesh->u(3*i+2)*t/double(nSteps));
+                        s3d_mesh->storage.coordinates[3*i]+amplification*s3d_mesh->u(3*i)*t/double(nSteps),
+                    s3d_mesh->storage.coordinates[3*i+1]+amplification*s3d_mesh->u(3*i+1)*t/double(nSteps),
+                    s3d_mesh->storage.coordinates[3*i+2]+amplification*s3d_mesh->u(3*i+2)*t/double(nSteps));
 
         vtkSmartPointer<vtkUnstructuredGrid> dataSet =
                 vtkSmartPointer<vtkUnstructuredGrid>::New();
@@ -561,10 +566,10 @@ void vtkGraphicWindow::addDataSet_simulation(/*Solid3D *mesh*/ void)
 
         for(int i=0; i<s3d_mesh->nElements; i++)
         {
-            vtkIdType ptIds[] = {s3d_mesh->elements[i]->nodes[0]->index,
-                                 s3d_mesh->elements[i]->nodes[1]->index,
-                                 s3d_mesh->elements[i]->nodes[2]->index,
-                                 s3d_mesh->elements[i]->nodes[3]->index};
+            vtkIdType ptIds[] = {s3d_mesh->storage.connectivity[4*i],
+                                 s3d_mesh->storage.connectivity[4*i+1],
+                                 s3d_mesh->storage.connectivity[4*i+2],
+                                 s3d_mesh->storage.connectivity[4*i+3]};
 
             dataSet->InsertNextCell( VTK_TETRA, 4, ptIds );
         }
@@ -626,6 +631,10 @@ void vtkGraphicWindow::ellipsoidGlyphsVisualization(void)
         return;
     }
 
+    s3d_mesh->evalResult(s3d_result);
+    for(int t=0; t<6; t++)
+        s3d_mesh->evalResult(t); // stress tensor
+
     removeDataSet();
 
 
@@ -657,9 +666,9 @@ void vtkGraphicWindow::ellipsoidGlyphsVisualization(void)
 
     for(int i=0; i<s3d_mesh->nNodes; i++)
         points->InsertNextPoint(
-                    s3d_mesh->nodes[i]->coordinates[0]+amplification*s3d_mesh->u(3*i),
-                s3d_mesh->nodes[i]->coordinates[1]+amplification*s3d_mesh->u(3*i+1),
-                s3d_mesh->nodes[i]->coordinates[2]+amplification*s3d_mesh->u(3*i+2));
+                    s3d_mesh->storage.coordinates[3*i]+amplification*s3d_mesh->u(3*i),
+                s3d_mesh->storage.coordinates[3*i+1]+amplification*s3d_mesh->u(3*i+1),
+                s3d_mesh->storage.coordinates[3*i+2]+amplification*s3d_mesh->u(3*i+2));
 
     vtkSmartPointer<vtkUnstructuredGrid> dataSet =
             vtkSmartPointer<vtkUnstructuredGrid>::New();
@@ -668,10 +677,10 @@ void vtkGraphicWindow::ellipsoidGlyphsVisualization(void)
 
     for(int i=0; i<s3d_mesh->nElements; i++)
     {
-        vtkIdType ptIds[] = {s3d_mesh->elements[i]->nodes[0]->index,
-                             s3d_mesh->elements[i]->nodes[1]->index,
-                             s3d_mesh->elements[i]->nodes[2]->index,
-                             s3d_mesh->elements[i]->nodes[3]->index};
+        vtkIdType ptIds[] = {s3d_mesh->storage.connectivity[4*i],
+                             s3d_mesh->storage.connectivity[4*i+1],
+                             s3d_mesh->storage.connectivity[4*i+2],
+                             s3d_mesh->storage.connectivity[4*i+3]};
 
 
 
@@ -789,6 +798,10 @@ void vtkGraphicWindow::hyperstreamlinesVisualization(void)
         return;
     }
 
+    s3d_mesh->evalResult(s3d_result);
+    for(int t=0; t<6; t++)
+        s3d_mesh->evalResult(t); // stress tensor
+
 
     removeDataSet();
 
@@ -812,9 +825,9 @@ void vtkGraphicWindow::hyperstreamlinesVisualization(void)
 
     for(int i=0; i<s3d_mesh->nNodes; i++)
         points->InsertNextPoint(
-                    s3d_mesh->nodes[i]->coordinates[0]+amplification*s3d_mesh->u(3*i),
-                s3d_mesh->nodes[i]->coordinates[1]+amplification*s3d_mesh->u(3*i+1),
-                s3d_mesh->nodes[i]->coordinates[2]+amplification*s3d_mesh->u(3*i+2));
+                    s3d_mesh->storage.coordinates[3*i]+amplification*s3d_mesh->u(3*i),
+                s3d_mesh->storage.coordinates[3*i+1]+amplification*s3d_mesh->u(3*i+1),
+                s3d_mesh->storage.coordinates[3*i+2]+amplification*s3d_mesh->u(3*i+2));
 
     vtkSmartPointer<vtkUnstructuredGrid> dataSet =
             vtkSmartPointer<vtkUnstructuredGrid>::New();
@@ -822,10 +835,10 @@ void vtkGraphicWindow::hyperstreamlinesVisualization(void)
 
     for(int i=0; i<s3d_mesh->nElements; i++)
     {
-        vtkIdType ptIds[] = {s3d_mesh->elements[i]->nodes[0]->index,
-                             s3d_mesh->elements[i]->nodes[1]->index,
-                             s3d_mesh->elements[i]->nodes[2]->index,
-                             s3d_mesh->elements[i]->nodes[3]->index};
+        vtkIdType ptIds[] = {s3d_mesh->storage.connectivity[4*i],
+                             s3d_mesh->storage.connectivity[4*i+1],
+                             s3d_mesh->storage.connectivity[4*i+2],
+                             s3d_mesh->storage.connectivity[4*i+3]};
 
         dataSet->InsertNextCell( VTK_TETRA, 4, ptIds );
     }
@@ -859,7 +872,7 @@ void vtkGraphicWindow::hyperstreamlinesVisualization(void)
         for(int i=0;i<s3d_mesh->nNodes;i++)
         {
             k=-1;
-            if(hsl_spPlanez0 && fabs(s3d_mesh->nodes[i]->coordinates[2])<1e-5)
+            if(hsl_spPlanez0 && fabs(s3d_mesh->storage.coordinates[3*i+2])<1e-5)
                 k = i;
             if(hsl_spRestrictions && (s3d_mesh->nodes[i]->restrictions[0] || s3d_mesh->nodes[i]->restrictions[1] || s3d_mesh->nodes[i]->restrictions[2]))
                 k = i;
@@ -877,9 +890,9 @@ void vtkGraphicWindow::hyperstreamlinesVisualization(void)
                     vtkSmartPointer<vtkHyperStreamline>::New();
             s1->SetInputData(dataSet);
             s1->SetStartPosition(
-                        s3d_mesh->nodes[k]->coordinates[0]+amplification*s3d_mesh->u(3*k),
-                    s3d_mesh->nodes[k]->coordinates[1]+amplification*s3d_mesh->u(3*k+1),
-                    s3d_mesh->nodes[k]->coordinates[2]+amplification*s3d_mesh->u(3*k+2));
+                        s3d_mesh->storage.coordinates[3*k]+amplification*s3d_mesh->u(3*k),
+                    s3d_mesh->storage.coordinates[3*k+1]+amplification*s3d_mesh->u(3*k+1),
+                    s3d_mesh->storage.coordinates[3*k+2]+amplification*s3d_mesh->u(3*k+2));
             if(hsl_v1)
                 s1->IntegrateMajorEigenvector();
             else if(hsl_v2)
@@ -984,6 +997,8 @@ void vtkGraphicWindow::isoSurfaceVisualization(void)
         MsgLog::error(QString("Model was not solved."));
         return;
     }
+
+    s3d_mesh->evalResult(s3d_result);
     removeDataSet();
 
 
@@ -992,9 +1007,9 @@ void vtkGraphicWindow::isoSurfaceVisualization(void)
 
     for(int i=0; i<s3d_mesh->nNodes; i++)
         points->InsertNextPoint(
-                    s3d_mesh->nodes[i]->coordinates[0]+amplification*s3d_mesh->u(3*i),
-                s3d_mesh->nodes[i]->coordinates[1]+amplification*s3d_mesh->u(3*i+1),
-                s3d_mesh->nodes[i]->coordinates[2]+amplification*s3d_mesh->u(3*i+2));
+                    s3d_mesh->storage.coordinates[3*i]+amplification*s3d_mesh->u(3*i),
+                s3d_mesh->storage.coordinates[3*i+1]+amplification*s3d_mesh->u(3*i+1),
+                s3d_mesh->storage.coordinates[3*i+2]+amplification*s3d_mesh->u(3*i+2));
 
     vtkSmartPointer<vtkUnstructuredGrid> dataSet =
             vtkSmartPointer<vtkUnstructuredGrid>::New();
@@ -1002,10 +1017,10 @@ void vtkGraphicWindow::isoSurfaceVisualization(void)
 
     for(int i=0; i<s3d_mesh->nElements; i++)
     {
-        vtkIdType ptIds[] = {s3d_mesh->elements[i]->nodes[0]->index,
-                             s3d_mesh->elements[i]->nodes[1]->index,
-                             s3d_mesh->elements[i]->nodes[2]->index,
-                             s3d_mesh->elements[i]->nodes[3]->index};
+        vtkIdType ptIds[] = {s3d_mesh->storage.connectivity[4*i],
+                             s3d_mesh->storage.connectivity[4*i+1],
+                             s3d_mesh->storage.connectivity[4*i+2],
+                             s3d_mesh->storage.connectivity[4*i+3]};
 
         dataSet->InsertNextCell( VTK_TETRA, 4, ptIds );
     }
@@ -1103,6 +1118,10 @@ void vtkGraphicWindow::superquadricsGlyphsVisualization(void)
         MsgLog::error(QString("Model was not solved."));
         return;
     }
+
+    s3d_mesh->evalResult(s3d_result);
+    for(int t=0; t<6; t++)
+        s3d_mesh->evalResult(t); // stress tensor
     removeDataSet();
 
     vtkSmartPointer<vtkDoubleArray> tensors = vtkSmartPointer<vtkDoubleArray>::New();
@@ -1130,9 +1149,9 @@ void vtkGraphicWindow::superquadricsGlyphsVisualization(void)
 
     for(int i=0; i<s3d_mesh->nNodes; i++)
         points->InsertNextPoint(
-                    s3d_mesh->nodes[i]->coordinates[0]+amplification*s3d_mesh->u(3*i),
-                s3d_mesh->nodes[i]->coordinates[1]+amplification*s3d_mesh->u(3*i+1),
-                s3d_mesh->nodes[i]->coordinates[2]+amplification*s3d_mesh->u(3*i+2));
+                    s3d_mesh->storage.coordinates[3*i]+amplification*s3d_mesh->u(3*i),
+                s3d_mesh->storage.coordinates[3*i+1]+amplification*s3d_mesh->u(3*i+1),
+                s3d_mesh->storage.coordinates[3*i+2]+amplification*s3d_mesh->u(3*i+2));
 
     vtkSmartPointer<vtkUnstructuredGrid> dataSet =
             vtkSmartPointer<vtkUnstructuredGrid>::New();
@@ -1141,10 +1160,10 @@ void vtkGraphicWindow::superquadricsGlyphsVisualization(void)
 
     for(int i=0; i<s3d_mesh->nElements; i++)
     {
-        vtkIdType ptIds[] = {s3d_mesh->elements[i]->nodes[0]->index,
-                             s3d_mesh->elements[i]->nodes[1]->index,
-                             s3d_mesh->elements[i]->nodes[2]->index,
-                             s3d_mesh->elements[i]->nodes[3]->index};
+        vtkIdType ptIds[] = {s3d_mesh->storage.connectivity[4*i],
+                             s3d_mesh->storage.connectivity[4*i+1],
+                             s3d_mesh->storage.connectivity[4*i+2],
+                             s3d_mesh->storage.connectivity[4*i+3]};
 
 
 
@@ -1172,17 +1191,24 @@ void vtkGraphicWindow::superquadricsGlyphsVisualization(void)
     dataSet->GetPointData()->SetScalars(scalars);
     dataSet->GetPointData()->SetTensors(tensors);
 
-    double tensor[9], w[3];
+    double w[3];
     int axis;
     double sum, cl, cp, theta, phi, gamma;
 
-    double **m = new double*[3];
-    double **v = new double*[3];
-    for(int i=0; i<3;i++)
-    {
-        m[i] = new double[3];
-        v[i] = new double[3];
-    }
+    // principal values and directions of all the nodes at once
+    int nNodes = s3d_mesh->nNodes;
+    std::vector<double> principal(18*size_t(nNodes));
+    double *components[9], *directions = &principal[9*size_t(nNodes)];
+    for(int t=0; t<9; t++)
+        components[t] = &principal[t*size_t(nNodes)];
+
+    for(int i=0; i<nNodes; i++)
+        for(int t=0; t<6; t++)
+            components[t][i] = s3d_mesh->Snodes(i,t); //n1, n2, n3, n12, n23, n31
+
+    evalPrincipalStresses(nNodes, components[0], components[1], components[2],
+                          components[3], components[4], components[5],
+                          components[6], components[7], components[8], directions);
 
 
     vtkSmartPointer<vtkAppendPolyData> append = vtkSmartPointer<vtkAppendPolyData>::New();
@@ -1205,9 +1231,9 @@ void vtkGraphicWindow::superquadricsGlyphsVisualization(void)
     {
 
         point->InsertPoint(0,
-                           s3d_mesh->nodes[i]->coordinates[0]+amplification*s3d_mesh->u(3*i),
-                s3d_mesh->nodes[i]->coordinates[1]+amplification*s3d_mesh->u(3*i+1),
-                s3d_mesh->nodes[i]->coordinates[2]+amplification*s3d_mesh->u(3*i+2));
+                           s3d_mesh->storage.coordinates[3*i]+amplification*s3d_mesh->u(3*i),
+                s3d_mesh->storage.coordinates[3*i+1]+amplification*s3d_mesh->u(3*i+1),
+                s3d_mesh->storage.coordinates[3*i+2]+amplification*s3d_mesh->u(3*i+2));
 
         node->SetPoints(point);
 
@@ -1226,14 +1252,11 @@ void vtkGraphicWindow::superquadricsGlyphsVisualization(void)
 
 
         node->GetPointData()->SetTensors(iTensor);
-        iTensor->GetTuple(0, tensor);
 
-
-        for (int j=0; j<3; j++)
-            for (int k=0; k<3; k++)
-                m[k][j] = tensor[k+3*j];
-
-        vtkMath::Jacobi(m, w, v);
+        w[0] = components[6][i];
+        w[1] = components[7][i];
+        w[2] = components[8][i];
+        const double *v = directions+9*size_t(i); // columns of the eigenvectors
         //std::cerr<<"\nw0="<<w[0]<<" w1="<<w[1]<<" w2="<<w[2];
 
         // Calculation according to equation (7) from
@@ -1284,7 +1307,7 @@ void vtkGraphicWindow::superquadricsGlyphsVisualization(void)
             continue;
         }
 
-        QVector3D e1(v[0][mv], v[1][mv], v[2][mv]);
+        QVector3D e1(v[3*mv+0], v[3*mv+1], v[3*mv+2]);
         e1.normalize();
 
         if(sqg_colorbyeigenvalues)
@@ -1418,9 +1441,9 @@ void vtkGraphicWindow::displacementVisualization(void)
 
     for(int i=0; i<s3d_mesh->nNodes; i++)
         points->InsertNextPoint(
-                    s3d_mesh->nodes[i]->coordinates[0]+amplification*s3d_mesh->u(3*i),
-                s3d_mesh->nodes[i]->coordinates[1]+amplification*s3d_mesh->u(3*i+1),
-                s3d_mesh->nodes[i]->coordinates[2]+amplification*s3d_mesh->u(3*i+2));
+                    s3d_mesh->storage.coordinates[3*i]+amplification*s3d_mesh->u(3*i),
+                s3d_mesh->storage.coordinates[3*i+1]+amplification*s3d_mesh->u(3*i+1),
+                s3d_mesh->storage.coordinates[3*i+2]+amplification*s3d_mesh->u(3*i+2));
 
     vtkSmartPointer<vtkUnstructuredGrid> dataSet =
             vtkSmartPointer<vtkUnstructuredGrid>::New();
@@ -1429,10 +1452,10 @@ void vtkGraphicWindow::displacementVisualization(void)
 
     for(int i=0; i<s3d_mesh->nElements; i++)
     {
-        vtkIdType ptIds[] = {s3d_mesh->elements[i]->nodes[0]->index,
-                             s3d_mesh->elements[i]->nodes[1]->index,
-                             s3d_mesh->elements[i]->nodes[2]->index,
-                             s3d_mesh->elements[i]->nodes[3]->index};
+        vtkIdType ptIds[] = {s3d_mesh->storage.connectivity[4*i],
+                             s3d_mesh->storage.connectivity[4*i+1],
+                             s3d_mesh->storage.connectivity[4*i+2],
+                             s3d_mesh->storage.connectivity[4*i+3]};
 
 
 
@@ -1761,12 +1784,12 @@ void vtkGraphicWindow::setupShowLoading(void)
             if(s3d_mesh->nodes[i])
                 maxLoad = magnitude > maxLoad? magnitude : maxLoad;
             points->InsertNextPoint(
-                        s3d_mesh->nodes[i]->coordinates[0]/*+amplification*s3d_mesh->u(3*i)*/,
-                    s3d_mesh->nodes[i]->coordinates[1]/*+amplification*s3d_mesh->u(3*i+1)*/,
-                    s3d_mesh->nodes[i]->coordinates[2]/*+amplification*s3d_mesh->u(3*i+2)*/);
+                        s3d_mesh->storage.coordinates[3*i]/*+amplification*s3d_mesh->u(3*i)*/,
+                    s3d_mesh->storage.coordinates[3*i+1]/*+amplification*s3d_mesh->u(3*i+1)*/,
+                    s3d_mesh->storage.coordinates[3*i+2]/*+amplification*s3d_mesh->u(3*i+2)*/);
 
-            loading->InsertTuple3(npt, signal*s3d_mesh->nodes[i]->loading[0],
-                    signal*s3d_mesh->nodes[i]->loading[1], signal*s3d_mesh->nodes[i]->loading[2]);
+            loading->InsertTuple3(npt, signal*s3d_mesh->storage.loading[3*i],
+                    signal*s3d_mesh->storage.loading[3*i+1], signal*s3d_mesh->storage.loading[3*i+2]);
 
             npt++;
         }
@@ -1833,16 +1856,16 @@ void vtkGraphicWindow::setupShowRestrictions(void)
         if(s3d_mesh->nodes[i]->restrictions[0])
         {
             points->InsertNextPoint(
-                        s3d_mesh->nodes[i]->coordinates[0]/*+amplification*s3d_mesh->u(3*i)*/,
-                    s3d_mesh->nodes[i]->coordinates[1]/*+amplification*s3d_mesh->u(3*i+1)*/,
-                    s3d_mesh->nodes[i]->coordinates[2]/*+amplification*s3d_mesh->u(3*i+2)*/);
+                        s3d_mesh->storage.coordinates[3*i]/*+amplification*s3d_mesh->u(3*i)*/,
+                    s3d_mesh->storage.coordinates[3*i+1]/*+amplification*s3d_mesh->u(3*i+1)*/,
+                    s3d_mesh->storage.coordinates[3*i+2]/*+amplification*s3d_mesh->u(3*i+2)*/);
             restrictions->InsertNextTuple3(1,0,0);
             colors->InsertNextTuple3(1,0,0);
 
             points->InsertNextPoint(
-                        s3d_mesh->nodes[i]->coordinates[0]/*+amplification*s3d_mesh->u(3*i)*/,
-                    s3d_mesh->nodes[i]->coordinates[1]/*+amplification*s3d_mesh->u(3*i+1)*/,
-                    s3d_mesh->nodes[i]->coordinates[2]/*+amplification*s3d_mesh->u(3*i+2)*/);
+                        s3d_mesh->storage.coordinates[3*i]/*+amplification*s3d_mesh->u(3*i)*/,
+                    s3d_mesh->storage.coordinates[3*i+1]/*+amplification*s3d_mesh->u(3*i+1)*/,
+                    s3d_mesh->storage.coordinates[3*i+2]/*+amplification*s3d_mesh->u(3*i+2)*/);
             restrictions->InsertNextTuple3(-1,0,0);
             colors->InsertNextTuple3(1,0,0);
         }
@@ -1851,16 +1874,16 @@ void vtkGraphicWindow::setupShowRestrictions(void)
         if(s3d_mesh->nodes[i]->restrictions[1])
         {
             points->InsertNextPoint(
-                        s3d_mesh->nodes[i]->coordinates[0]/*+amplification*s3d_mesh->u(3*i)*/,
-                    s3d_mesh->nodes[i]->coordinates[1]/*+amplification*s3d_mesh->u(3*i+1)*/,
-                    s3d_mesh->nodes[i]->coordinates[2]/*+amplification*s3d_mesh->u(3*i+2)*/);
+                        s3d_mesh->storage.coordinates[3*i]/*+amplification*s3d_mesh->u(3*i)*/,
+                    s3d_mesh->storage.coordinates[3*i+1]/*+amplification*s3d_mesh->u(3*i+1)*/,
+                    s3d_mesh->storage.coordinates[3*i+2]/*+amplification*s3d_mesh->u(3*i+2)*/);
             restrictions->InsertNextTuple3(0,1,0);
             colors->InsertNextTuple3(0,1,0);
 
             points->InsertNextPoint(
-                        s3d_mesh->nodes[i]->coordinates[0]/*+amplification*s3d_mesh->u(3*i)*/,
-                    s3d_mesh->nodes[i]->coordinates[1]/*+amplification*s3d_mesh->u(3*i+1)*/,
-                    s3d_mesh->nodes[i]->coordinates[2]/*+amplification*s3d_mesh->u(3*i+2)*/);
+                        s3d_mesh->storage.coordinates[3*i]/*+amplification*s3d_mesh->u(3*i)*/,
+                    s3d_mesh->storage.coordinates[3*i+1]/*+amplification*s3d_mesh->u(3*i+1)*/,
+                    s3d_mesh->storage.coordinates[3*i+2]/*+amplification*s3d_mesh->u(3*i+2)*/);
             restrictions->InsertNextTuple3(0,-1,0);
             colors->InsertNextTuple3(0,1,0);
         }
@@ -1869,16 +1892,16 @@ void vtkGraphicWindow::setupShowRestrictions(void)
         if(s3d_mesh->nodes[i]->restrictions[2])
         {
             points->InsertNextPoint(
-                        s3d_mesh->nodes[i]->coordinates[0]/*+amplification*s3d_mesh->u(3*i)*/,
-                    s3d_mesh->nodes[i]->coordinates[1]/*+amplification*s3d_mesh->u(3*i+1)*/,
-                    s3d_mesh->nodes[i]->coordinates[2]/*+amplification*s3d_mesh->u(3*i+2)*/);
+                        s3d_mesh->storage.coordinates[3*i]/*+amplification*s3d_mesh->u(3*i)*/,
+                    s3d_mesh->storage.coordinates[3*i+1]/*+amplification*s3d_mesh->u(3*i+1)*/,
+                    s3d_mesh->storage.coordinates[3*i+2]/*+amplification*s3d_mesh->u(3*i+2)*/);
             restrictions->InsertNextTuple3(0,0,1);
             colors->InsertNextTuple3(0,0,1);
 
             points->InsertNextPoint(
-                        s3d_mesh->nodes[i]->coordinates[0]/*+amplification*s3d_mesh->u(3*i)*/,
-                    s3d_mesh->nodes[i]->coordinates[1]/*+amplification*s3d_mesh->u(3*i+1)*/,
-                    s3d_mesh->nodes[i]->coordinates[2]/*+amplification*s3d_mesh->u(3*i+2)*/);
+                        s3d_mesh->storage.coordinates[3*i]/*+amplification*s3d_mesh->u(3*i)*/,
+                    s3d_mesh->storage.coordinates[3*i+1]/*+amplification*s3d_mesh->u(3*i+1)*/,
+                    s3d_mesh->storage.coordinates[3*i+2]/*+amplification*s3d_mesh->u(3*i+2)*/);
             restrictions->InsertNextTuple3(0,0,-1);
             colors->InsertNextTuple3(0,0,1);
         }
@@ -1995,25 +2018,27 @@ void vtkGraphicWindow::planeCutter(void)
         return;
     }
 
+    s3d_mesh->evalResult(s3d_result);
+
     removeDataSet();
     vtkSmartPointer< vtkPoints > points =
             vtkSmartPointer< vtkPoints > :: New();
 
     for(int i=0; i<s3d_mesh->nNodes; i++)
         points->InsertNextPoint(
-                    s3d_mesh->nodes[i]->coordinates[0]+amplification*s3d_mesh->u(3*i),
-                s3d_mesh->nodes[i]->coordinates[1]+amplification*s3d_mesh->u(3*i+1),
-                s3d_mesh->nodes[i]->coordinates[2]+amplification*s3d_mesh->u(3*i+2));
+                    s3d_mesh->storage.coordinates[3*i]+amplification*s3d_mesh->u(3*i),
+                s3d_mesh->storage.coordinates[3*i+1]+amplification*s3d_mesh->u(3*i+1),
+                s3d_mesh->storage.coordinates[3*i+2]+amplification*s3d_mesh->u(3*i+2));
 
     dataSet_1 = vtkSmartPointer<vtkUnstructuredGrid>::New();
     dataSet_1->SetPoints(points);
 
     for(int i=0; i<s3d_mesh->nElements; i++)
     {
-        vtkIdType ptIds[] = {s3d_mesh->elements[i]->nodes[0]->index,
-                             s3d_mesh->elements[i]->nodes[1]->index,
-                             s3d_mesh->elements[i]->nodes[2]->index,
-                             s3d_mesh->elements[i]->nodes[3]->index};
+        vtkIdType ptIds[] = {s3d_mesh->storage.connectivity[4*i],
+                             s3d_mesh->storage.connectivity[4*i+1],
+                             s3d_mesh->storage.connectivity[4*i+2],
+                             s3d_mesh->storage.connectivity[4*i+3]};
 
         dataSet_1->InsertNextCell( VTK_TETRA, 4, ptIds );
     }